@@ -0,0 +1,177 @@
+#include <cstdint>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "cipher-aes-cbc.hpp"
+#include "mime-base16.hpp"
+#include "taptests.hpp"
+
+std::string
+decode_hex (std::string const& hex)
+{
+    std::string octets;
+    mime::decode_hex (hex, octets);
+    return octets;
+}
+
+template<std::size_t N>
+std::array<std::uint8_t,N>
+decode_key (std::string const& keyhex)
+{
+    std::string const octets = decode_hex (keyhex);
+    std::array<std::uint8_t,N> key {{0}};
+    std::copy (octets.cbegin (), octets.cend (), key.begin ());
+    return key;
+}
+
+std::string
+long_text (std::size_t const n)
+{
+    std::string plaintext (n, 0);
+    for (std::size_t i = 0; i < n; ++i)
+        plaintext[i] = static_cast<char> (i * 7 + 3);
+    return plaintext;
+}
+
+// NIST SP 800-38A F.2 CBC Example Vectors
+void
+test_sp800_38a (test::simple& ts)
+{
+    std::string const iv = decode_hex ("000102030405060708090a0b0c0d0e0f");
+    std::string const plaintext = decode_hex (
+        "6bc1bee22e409f96e93d7e117393172a"
+        "ae2d8a571e03ac9c9eb76fac45af8e51"
+        "30c81c46a35ce411e5fbc1191a0a52ef"
+        "f69f2445df4f9b17ad2b417be66c3710");
+
+    cipher::AES_CBC cbc128;
+    cbc128.set_key128 (decode_key<16> ("2b7e151628aed2a6abf7158809cf4f3c"));
+    cbc128.set_iv (iv);
+    std::string const ciphertext128 = cbc128.encrypt (plaintext);
+    ts.ok (ciphertext128 == decode_hex (
+        "7649abac8119b246cee98e9b12e9197d"
+        "5086cb9b507219ee95db113a917678b2"
+        "73bed6b8e3c1743b7116e69e22229516"
+        "3ff1caa1681fac09120eca307586e1a7"), "F.2.1 CBC-AES128.Encrypt");
+    cbc128.set_iv (iv);
+    ts.ok (cbc128.decrypt (ciphertext128) == plaintext, "F.2.2 CBC-AES128.Decrypt");
+
+    cipher::AES_CBC cbc192;
+    cbc192.set_key192 (decode_key<24> ("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b"));
+    cbc192.set_iv (iv);
+    ts.ok (cbc192.encrypt (plaintext) == decode_hex (
+        "4f021db243bc633d7178183a9fa071e8"
+        "b4d9ada9ad7dedf4e5e738763f69145a"
+        "571b242012fb7ae07fa9baac3df102e0"
+        "08b0e27988598881d920a9e64f5615cd"), "F.2.3 CBC-AES192.Encrypt");
+
+    cipher::AES_CBC cbc256;
+    cbc256.set_key256 (decode_key<32> (
+        "603deb1015ca71be2b73aef0857d7781"
+        "1f352c073b6108d72d9810a30914dff4"));
+    cbc256.set_iv (iv);
+    std::string const ciphertext256 = cbc256.encrypt (plaintext);
+    ts.ok (ciphertext256 == decode_hex (
+        "f58c4c04d6e5f1ba779eabfb5f7bfbd6"
+        "9cfc4e967edb808d679f777bc6702c7d"
+        "39f23369a9d9bacfa530e26304231461"
+        "b2eb05e2c39be9fcda6c19078c6a9d1b"), "F.2.5 CBC-AES256.Encrypt");
+    cbc256.set_iv (iv);
+    ts.ok (cbc256.decrypt (ciphertext256) == plaintext, "F.2.6 CBC-AES256.Decrypt");
+}
+
+// the chaining value goes on over calls, the same as openssl aes-128-cbc
+// on the whole text.
+void
+test_stream (test::simple& ts)
+{
+    std::string const iv = decode_hex ("f0e0d0c0b0a090807060504030201000");
+    std::string const plaintext = long_text (1U << 20);
+    cipher::AES_CBC cbc;
+    cbc.set_key128 (decode_key<16> ("000102030405060708090a0b0c0d0e0f"));
+    cbc.set_iv (iv);
+    std::string ciphertext (plaintext.size (), 0);
+    for (std::size_t i = 0; i < plaintext.size (); ) {
+        std::size_t const n = std::min<std::size_t> (7 * 16, plaintext.size () - i);
+        cbc.encrypt (&plaintext[i], n, &ciphertext[i]);
+        i += n;
+    }
+    ts.ok (ciphertext.substr (0, 16) == decode_hex ("2b021cf120e4270324eaa47713c4fcb0")
+        && ciphertext.substr (ciphertext.size () - 16) == decode_hex (
+        "2821961807ab719cb196ee7af1c2820a"), "encrypt 7 blocks at a time");
+
+    cbc.set_iv (iv);
+    std::string got (plaintext.size (), 0);
+    for (std::size_t i = 0; i < ciphertext.size (); ) {
+        std::size_t const n = std::min<std::size_t> (37 * 16, ciphertext.size () - i);
+        cbc.decrypt (&ciphertext[i], n, &got[i]);
+        i += n;
+    }
+    ts.ok (got == plaintext, "decrypt 37 blocks at a time");
+
+    cbc.set_iv (iv);
+    std::string buf (ciphertext);
+    cbc.decrypt (&buf[0], buf.size (), &buf[0]);
+    ts.ok (buf == plaintext, "decrypt in place");
+}
+
+void
+test_parallel (test::simple& ts)
+{
+    std::string const iv = decode_hex ("f0e0d0c0b0a090807060504030201000");
+    std::string const plaintext = long_text ((1U << 20) + 48);
+    cipher::AES_CBC cbc;
+    cbc.set_key256 (decode_key<32> (
+        "603deb1015ca71be2b73aef0857d7781"
+        "1f352c073b6108d72d9810a30914dff4"));
+    cbc.set_iv (iv);
+    std::string const ciphertext = cbc.encrypt (plaintext);
+
+    cbc.set_iv (iv);
+    std::string got (plaintext.size (), 0);
+    cbc.decrypt_parallel (ciphertext.data (), ciphertext.size (), &got[0], 4);
+    ts.ok (got == plaintext, "decrypt_parallel");
+
+    cbc.set_iv (iv);
+    std::string buf (ciphertext);
+    cbc.decrypt_parallel (&buf[0], 4096 * 16 * 5 + 32, &buf[0], 3);
+    std::size_t const rest = 4096 * 16 * 5 + 32;
+    cbc.decrypt_parallel (&buf[rest], buf.size () - rest, &buf[rest], 3);
+    ts.ok (buf == plaintext, "decrypt_parallel in place and goes on");
+}
+
+void
+test_invalid (test::simple& ts)
+{
+    cipher::AES_CBC cbc;
+    bool thrown = false;
+    try {
+        cbc.set_iv (std::string (12, 0));
+    }
+    catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    ts.ok (thrown, "iv must be 16 octets");
+
+    cbc.set_key128 (decode_key<16> ("000102030405060708090a0b0c0d0e0f"));
+    thrown = false;
+    try {
+        cbc.encrypt (std::string (17, 0));
+    }
+    catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    ts.ok (thrown, "size must be a multiple of 16");
+}
+
+int
+main (int argc, char* argv[])
+{
+    test::simple ts (12);
+    test_sp800_38a (ts);
+    test_stream (ts);
+    test_parallel (ts);
+    test_invalid (ts);
+    return ts.done_testing ();
+}
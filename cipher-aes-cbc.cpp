@@ -0,0 +1,210 @@
+#include <cstdint>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <system_error>
+#include <stdexcept>
+#include "cipher-aes-cbc.hpp"
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+enum { NBULK = 16, NCHUNK = 4096 };
+
+static inline void
+check_size (std::size_t const size)
+{
+    if (size % AES::BLOCKSIZE != 0)
+        throw std::runtime_error ("aes-cbc size must be a multiple of 16.");
+}
+
+// nblock blocks chained from iv, NBULK blocks at a time through
+// decrypt_blocks. the cipher blocks are copied before dst gets
+// the plain blocks, so that dst may be the same as src.
+static void
+decrypt_chain (AES& aes, AES::BLOCK const& iv,
+    std::uint8_t const* src, std::uint8_t* dst, std::size_t nblock)
+{
+    AES::BLOCK chain (iv);
+    AES::BLOCK secret[NBULK];
+    AES::BLOCK plain[NBULK];
+    while (nblock > 0) {
+        std::size_t const m = std::min<std::size_t> (NBULK, nblock);
+        for (std::size_t k = 0; k < m; ++k)
+            std::copy (src + k * AES::BLOCKSIZE, src + (k + 1) * AES::BLOCKSIZE,
+                secret[k].begin ());
+        aes.decrypt_blocks (secret, plain, m);
+        for (std::size_t k = 0; k < m; ++k) {
+            AES::BLOCK const& prev = 0 == k ? chain : secret[k - 1];
+            for (int j = 0; j < AES::BLOCKSIZE; ++j)
+                dst[k * AES::BLOCKSIZE + j] = plain[k][j] ^ prev[j];
+        }
+        chain = secret[m - 1];
+        src += m * AES::BLOCKSIZE;
+        dst += m * AES::BLOCKSIZE;
+        nblock -= m;
+    }
+}
+
+AES_CBC::AES_CBC (void) : aes (), iv {{0}}
+{
+}
+
+AES_CBC&
+AES_CBC::set_key128 (std::array<std::uint8_t,16> const& key128)
+{
+    aes.set_encrypt_key128 (key128);
+    aes.set_decrypt_key128 (key128);
+    return *this;
+}
+
+AES_CBC&
+AES_CBC::set_key192 (std::array<std::uint8_t,24> const& key192)
+{
+    aes.set_encrypt_key192 (key192);
+    aes.set_decrypt_key192 (key192);
+    return *this;
+}
+
+AES_CBC&
+AES_CBC::set_key256 (std::array<std::uint8_t,32> const& key256)
+{
+    aes.set_encrypt_key256 (key256);
+    aes.set_decrypt_key256 (key256);
+    return *this;
+}
+
+AES_CBC&
+AES_CBC::set_iv (std::string const& a)
+{
+    if (a.size () != AES::BLOCKSIZE)
+        throw std::runtime_error ("aes-cbc iv size must be 16.");
+    std::copy (a.cbegin (), a.cend (), iv.begin ());
+    return *this;
+}
+
+void
+AES_CBC::encrypt (void const* src, std::size_t const size, void* dst)
+{
+    check_size (size);
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    for (std::size_t i = 0; i < size; i += AES::BLOCKSIZE) {
+        for (int j = 0; j < AES::BLOCKSIZE; ++j)
+            iv[j] ^= s[i + j];
+        aes.encrypt (iv, iv);
+        std::copy (iv.cbegin (), iv.cend (), d + i);
+    }
+}
+
+void
+AES_CBC::decrypt (void const* src, std::size_t const size, void* dst)
+{
+    check_size (size);
+    if (0 == size)
+        return;
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    AES::BLOCK last;
+    std::copy (s + size - AES::BLOCKSIZE, s + size, last.begin ());
+    decrypt_chain (aes, iv, s, static_cast<std::uint8_t*> (dst), size / AES::BLOCKSIZE);
+    iv = last;
+}
+
+// each chunk of NCHUNK blocks chains from the last cipher block of
+// the chunk before it, which is saved ahead for dst may be src. the
+// workers have their own copies of the round keys, and the caller
+// works along with them.
+void
+AES_CBC::decrypt_parallel (void const* src, std::size_t const size, void* dst,
+    std::size_t nthread)
+{
+    check_size (size);
+    std::size_t const nblock = size / AES::BLOCKSIZE;
+    std::size_t const nchunk = (nblock + NCHUNK - 1) / NCHUNK;
+    if (0 == nthread)
+        nthread = std::max<std::size_t> (1, std::thread::hardware_concurrency ());
+    nthread = std::min<std::size_t> (nthread, nchunk);
+    if (nthread <= 1) {
+        decrypt (src, size, dst);
+        return;
+    }
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    std::vector<AES::BLOCK> chains (nchunk + 1);
+    chains[0] = iv;
+    for (std::size_t i = 1; i <= nchunk; ++i) {
+        std::size_t const b = std::min<std::size_t> (i * NCHUNK, nblock) - 1;
+        std::copy (s + b * AES::BLOCKSIZE, s + (b + 1) * AES::BLOCKSIZE, chains[i].begin ());
+    }
+    std::atomic<std::size_t> next (0);
+    auto work = [&] () {
+        AES a (aes);
+        for (std::size_t i; (i = next++) < nchunk; ) {
+            std::size_t const b = i * NCHUNK;
+            std::size_t const m = std::min<std::size_t> (NCHUNK, nblock - b);
+            decrypt_chain (a, chains[i], s + b * AES::BLOCKSIZE, d + b * AES::BLOCKSIZE, m);
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve (nthread - 1);
+    try {
+        while (workers.size () < nthread - 1)
+            workers.emplace_back (work);
+    }
+    catch (std::system_error const&) {
+        // leave the rest of the chunks to the started threads and to us
+    }
+    work ();
+    for (std::thread& worker : workers)
+        worker.join ();
+    iv = chains[nchunk];
+}
+
+std::string
+AES_CBC::encrypt (octets::view const& src)
+{
+    std::string dst (src.size (), 0);
+    encrypt (src.data (), src.size (), &dst[0]);
+    return dst;
+}
+
+std::string
+AES_CBC::decrypt (octets::view const& src)
+{
+    std::string dst (src.size (), 0);
+    decrypt (src.data (), src.size (), &dst[0]);
+    return dst;
+}
+
+}//namespace cipher
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
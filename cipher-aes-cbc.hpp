@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <array>
+#include "octets-view.hpp"
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+// AES in the cipher block chaining mode of NIST SP 800-38A.
+// encrypt and decrypt take whole blocks without padding, and the
+// chaining value goes on from one call to the next, so that a long
+// stream goes in pieces. decryption runs many blocks at once, since
+// each plain block needs only two cipher blocks.
+class AES_CBC {
+public:
+    explicit AES_CBC (void);
+    AES_CBC& set_key128 (std::array<std::uint8_t,16> const& key128);
+    AES_CBC& set_key192 (std::array<std::uint8_t,24> const& key192);
+    AES_CBC& set_key256 (std::array<std::uint8_t,32> const& key256);
+    // the initialization vector of 16 octets.
+    AES_CBC& set_iv (std::string const& a);
+
+    std::string encrypt (octets::view const& src);
+    std::string decrypt (octets::view const& src);
+    // size is a multiple of 16, and dst may be the same as src.
+    void encrypt (void const* src, std::size_t const size, void* dst);
+    void decrypt (void const* src, std::size_t const size, void* dst);
+    // the same as decrypt, with the blocks split into ranges over up to
+    // nthread threads, nthread 0 meaning one per hardware thread.
+    void decrypt_parallel (void const* src, std::size_t const size, void* dst,
+        std::size_t nthread = 0);
+
+private:
+    AES aes;
+    AES::BLOCK iv;
+};
+
+}//namespace cipher
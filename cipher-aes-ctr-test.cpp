@@ -0,0 +1,174 @@
+#include <cstdint>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "cipher-aes-ctr.hpp"
+#include "mime-base16.hpp"
+#include "taptests.hpp"
+
+std::string
+decode_hex (std::string const& hex)
+{
+    std::string octets;
+    mime::decode_hex (hex, octets);
+    return octets;
+}
+
+template<std::size_t N>
+std::array<std::uint8_t,N>
+decode_key (std::string const& keyhex)
+{
+    std::string const octets = decode_hex (keyhex);
+    std::array<std::uint8_t,N> key {{0}};
+    std::copy (octets.cbegin (), octets.cend (), key.begin ());
+    return key;
+}
+
+std::string
+long_text (std::size_t const n)
+{
+    std::string plaintext (n, 0);
+    for (std::size_t i = 0; i < n; ++i)
+        plaintext[i] = static_cast<char> (i * 7 + 3);
+    return plaintext;
+}
+
+// NIST SP 800-38A F.5 CTR Example Vectors
+void
+test_sp800_38a (test::simple& ts)
+{
+    std::string const counter = decode_hex ("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    std::string const plaintext = decode_hex (
+        "6bc1bee22e409f96e93d7e117393172a"
+        "ae2d8a571e03ac9c9eb76fac45af8e51"
+        "30c81c46a35ce411e5fbc1191a0a52ef"
+        "f69f2445df4f9b17ad2b417be66c3710");
+
+    cipher::AES_CTR ctr128;
+    ctr128.set_key128 (decode_key<16> ("2b7e151628aed2a6abf7158809cf4f3c"));
+    ctr128.set_counter (counter);
+    std::string const ciphertext128 = ctr128.update (plaintext);
+    ts.ok (ciphertext128 == decode_hex (
+        "874d6191b620e3261bef6864990db6ce"
+        "9806f66b7970fdff8617187bb9fffdff"
+        "5ae4df3edbd5d35e5b4f09020db03eab"
+        "1e031dda2fbe03d1792170a0f3009cee"), "F.5.1 CTR-AES128.Encrypt");
+    ctr128.seek (0);
+    ts.ok (ctr128.update (ciphertext128) == plaintext, "F.5.2 CTR-AES128.Decrypt");
+
+    cipher::AES_CTR ctr192;
+    ctr192.set_key192 (decode_key<24> ("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b"));
+    ctr192.set_counter (counter);
+    ts.ok (ctr192.update (plaintext) == decode_hex (
+        "1abc932417521ca24f2b0459fe7e6e0b"
+        "090339ec0aa6faefd5ccc2c6f4ce8e94"
+        "1e36b26bd1ebc670d1bd1d665620abf7"
+        "4f78a7f6d29809585a97daec58c6b050"), "F.5.3 CTR-AES192.Encrypt");
+
+    cipher::AES_CTR ctr256;
+    ctr256.set_key256 (decode_key<32> (
+        "603deb1015ca71be2b73aef0857d7781"
+        "1f352c073b6108d72d9810a30914dff4"));
+    ctr256.set_counter (counter);
+    ts.ok (ctr256.update (plaintext) == decode_hex (
+        "601ec313775789a5b7a7f504bbf3d228"
+        "f443e3ca4d62b59aca84e990cacaf5c5"
+        "2b0930daa23de94ce87017ba2d84988d"
+        "dfc9c58db67aada613c2dd08457941a6"), "F.5.5 CTR-AES256.Encrypt");
+}
+
+// the counter block wraps around to zero as openssl aes-128-ctr does.
+void
+test_wrap (test::simple& ts)
+{
+    cipher::AES_CTR ctr;
+    ctr.set_key128 (decode_key<16> ("2b7e151628aed2a6abf7158809cf4f3c"));
+    ctr.set_counter (decode_hex ("ffffffffffffffffffffffffffffffff"));
+    ts.ok (ctr.update (std::string (48, 0)) == decode_hex (
+        "8af2860142f786f409307c1a3f7eaaac"
+        "7df76b0c1ab899b33e42f047b91b546f"
+        "57127d4034b1bebfaef466b9c7726fc6"), "counter wraps around");
+}
+
+void
+test_seek (test::simple& ts)
+{
+    cipher::AES_CTR ctr;
+    ctr.set_key256 (decode_key<32> (
+        "603deb1015ca71be2b73aef0857d7781"
+        "1f352c073b6108d72d9810a30914dff4"));
+    ctr.set_counter (decode_hex ("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+    std::string const plaintext = long_text (1000);
+    std::string const ciphertext = ctr.update (plaintext);
+    ts.ok (ctr.tell () == 1000, "tell after update");
+
+    bool ok = true;
+    std::size_t const offsets[] = {999, 0, 5, 16, 31, 200, 511, 512, 700};
+    for (std::size_t const off : offsets) {
+        std::size_t const n = std::min<std::size_t> (300, 1000 - off);
+        ctr.seek (off);
+        std::string const got = ctr.update (plaintext.substr (off, n));
+        ok = ok && got == ciphertext.substr (off, n) && ctr.tell () == off + n;
+    }
+    ts.ok (ok, "seek to any offset");
+
+    ctr.seek (0);
+    std::string chunked (plaintext.size (), 0);
+    for (std::size_t i = 0; i < plaintext.size (); i += 7) {
+        std::size_t const n = std::min<std::size_t> (7, plaintext.size () - i);
+        ctr.update (&plaintext[i], n, &chunked[i]);
+    }
+    ts.ok (chunked == ciphertext, "7 octets at a time");
+
+    ctr.seek (3);
+    std::string buf (plaintext);
+    ctr.update (&buf[3], buf.size () - 3, &buf[3]);
+    ts.ok (buf.substr (3) == ciphertext.substr (3), "in place");
+}
+
+void
+test_parallel (test::simple& ts)
+{
+    cipher::AES_CTR ctr;
+    ctr.set_key128 (decode_key<16> ("000102030405060708090a0b0c0d0e0f"));
+    ctr.set_counter (decode_hex ("00000000000000000000000000000000"));
+    std::string const plaintext = long_text ((1U << 20) + 21);
+    std::string const ciphertext = ctr.update (plaintext);
+
+    ctr.seek (0);
+    std::string got (plaintext.size (), 0);
+    ctr.update_parallel (plaintext.data (), plaintext.size (), &got[0], 4);
+    ts.ok (got == ciphertext && ctr.tell () == plaintext.size (), "update_parallel");
+
+    ctr.seek (9);
+    std::string buf (plaintext);
+    ctr.update_parallel (&buf[9], buf.size () - 9, &buf[9], 3);
+    ts.ok (buf.substr (9) == ciphertext.substr (9), "update_parallel at an offset in place");
+}
+
+void
+test_invalid_counter (test::simple& ts)
+{
+    cipher::AES_CTR ctr;
+    bool thrown = false;
+    try {
+        ctr.set_counter (std::string (12, 0));
+    }
+    catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    ts.ok (thrown, "counter must be 16 octets");
+}
+
+int
+main (int argc, char* argv[])
+{
+    test::simple ts (12);
+    test_sp800_38a (ts);
+    test_wrap (ts);
+    test_seek (ts);
+    test_parallel (ts);
+    test_invalid_counter (ts);
+    return ts.done_testing ();
+}
@@ -0,0 +1,228 @@
+#include <cstdint>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <system_error>
+#include <stdexcept>
+#include "cipher-aes-ctr.hpp"
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+enum { NCHUNK = 4096 };
+
+// ctr = counter0 + block in 128-bit big-endian
+static inline void
+add_counter (AES::BLOCK const& counter0, std::uint64_t block, AES::BLOCK& ctr)
+{
+    unsigned int carry = 0;
+    for (int i = AES::BLOCKSIZE - 1; i >= 0; --i) {
+        unsigned int const x = counter0[i] + (block & 0xffU) + carry;
+        ctr[i] = static_cast<std::uint8_t> (x);
+        carry = x >> 8;
+        block >>= 8;
+    }
+}
+
+AES_CTR::AES_CTR (void)
+    : aes (), counter0 {{0}}, offset (0), key_stream_block (0), key_stream_ready (false)
+{
+}
+
+AES_CTR&
+AES_CTR::set_key128 (std::array<std::uint8_t,16> const& key128)
+{
+    aes.set_encrypt_key128 (key128);
+    key_stream_ready = false;
+    return *this;
+}
+
+AES_CTR&
+AES_CTR::set_key192 (std::array<std::uint8_t,24> const& key192)
+{
+    aes.set_encrypt_key192 (key192);
+    key_stream_ready = false;
+    return *this;
+}
+
+AES_CTR&
+AES_CTR::set_key256 (std::array<std::uint8_t,32> const& key256)
+{
+    aes.set_encrypt_key256 (key256);
+    key_stream_ready = false;
+    return *this;
+}
+
+AES_CTR&
+AES_CTR::set_counter (std::string const& a)
+{
+    if (a.size () != AES::BLOCKSIZE)
+        throw std::runtime_error ("aes-ctr counter size must be 16.");
+    std::copy (a.cbegin (), a.cend (), counter0.begin ());
+    key_stream_ready = false;
+    offset = 0;
+    return *this;
+}
+
+AES_CTR&
+AES_CTR::seek (std::uint64_t const x)
+{
+    offset = x;
+    return *this;
+}
+
+std::uint64_t
+AES_CTR::tell (void) const
+{
+    return offset;
+}
+
+// n octets within the block at offset, whose key stream
+// stays for the next update to go on in the same block.
+void
+AES_CTR::xor_partial (std::uint8_t const* src, std::uint8_t* dst, std::size_t const n)
+{
+    std::uint64_t const block = offset / AES::BLOCKSIZE;
+    std::size_t const pos = offset % AES::BLOCKSIZE;
+    if (! key_stream_ready || key_stream_block != block) {
+        AES::BLOCK ctr;
+        add_counter (counter0, block, ctr);
+        aes.encrypt (ctr, key_stream);
+        key_stream_block = block;
+        key_stream_ready = true;
+    }
+    for (std::size_t j = 0; j < n; ++j)
+        dst[j] = src[j] ^ key_stream[pos + j];
+    offset += n;
+}
+
+void
+AES_CTR::update (void const* src, std::size_t size, void* dst)
+{
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    std::size_t const pos = offset % AES::BLOCKSIZE;
+    if (pos > 0 && size > 0) {
+        std::size_t const n = std::min<std::size_t> (AES::BLOCKSIZE - pos, size);
+        xor_partial (s, d, n);
+        s += n;
+        d += n;
+        size -= n;
+    }
+    std::size_t const nblock = size / AES::BLOCKSIZE;
+    AES::BLOCK ctr;
+    add_counter (counter0, offset / AES::BLOCKSIZE, ctr);
+    aes.xor_counter_blocks (AES::COUNTER_INC128, ctr, s, d, nblock);
+    offset += nblock * AES::BLOCKSIZE;
+    s += nblock * AES::BLOCKSIZE;
+    d += nblock * AES::BLOCKSIZE;
+    size -= nblock * AES::BLOCKSIZE;
+    if (size > 0)
+        xor_partial (s, d, size);
+}
+
+// the workers take NCHUNK blocks at a time, each with its own copy
+// of the round keys, and the caller works along with them.
+void
+AES_CTR::update_parallel (void const* src, std::size_t size, void* dst, std::size_t nthread)
+{
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    std::size_t const pos = offset % AES::BLOCKSIZE;
+    std::size_t const head = pos > 0 ? std::min<std::size_t> (AES::BLOCKSIZE - pos, size) : 0;
+    update (s, head, d);
+    s += head;
+    d += head;
+    size -= head;
+    std::size_t const nblock = size / AES::BLOCKSIZE;
+    std::size_t const nchunk = (nblock + NCHUNK - 1) / NCHUNK;
+    if (0 == nthread)
+        nthread = std::max<std::size_t> (1, std::thread::hardware_concurrency ());
+    nthread = std::min<std::size_t> (nthread, nchunk);
+    if (nthread <= 1) {
+        update (s, size, d);
+        return;
+    }
+    std::uint64_t const block0 = offset / AES::BLOCKSIZE;
+    std::atomic<std::size_t> next (0);
+    auto work = [&] () {
+        AES a (aes);
+        for (std::size_t i; (i = next++) < nchunk; ) {
+            std::size_t const b = i * NCHUNK;
+            std::size_t const m = std::min<std::size_t> (NCHUNK, nblock - b);
+            AES::BLOCK ctr;
+            add_counter (counter0, block0 + b, ctr);
+            a.xor_counter_blocks (AES::COUNTER_INC128, ctr, s + b * AES::BLOCKSIZE,
+                d + b * AES::BLOCKSIZE, m);
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve (nthread - 1);
+    try {
+        while (workers.size () < nthread - 1)
+            workers.emplace_back (work);
+    }
+    catch (std::system_error const&) {
+        // leave the rest of the chunks to the started threads and to us
+    }
+    work ();
+    for (std::thread& worker : workers)
+        worker.join ();
+    offset += nblock * AES::BLOCKSIZE;
+    s += nblock * AES::BLOCKSIZE;
+    d += nblock * AES::BLOCKSIZE;
+    update (s, size - nblock * AES::BLOCKSIZE, d);
+}
+
+std::string
+AES_CTR::update (octets::view const& src)
+{
+    std::string dst (src.size (), 0);
+    update (src.data (), src.size (), &dst[0]);
+    return dst;
+}
+
+std::string
+AES_CTR::update (std::string::const_iterator s, std::string::const_iterator e)
+{
+    return update (octets::view (s, e));
+}
+
+std::string
+AES_CTR::update (std::string const& src)
+{
+    return update (octets::view (src));
+}
+
+}//namespace cipher
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
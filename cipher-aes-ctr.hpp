@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <array>
+#include "octets-view.hpp"
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+// AES in the counter mode of NIST SP 800-38A.
+// the counter block is a 128-bit big-endian integer that starts at the
+// initial counter block and wraps around. seek goes to any octet of the
+// key stream at once, so that encrypted storage reads at any offset.
+// update both encrypts and decrypts.
+class AES_CTR {
+public:
+    explicit AES_CTR (void);
+    AES_CTR& set_key128 (std::array<std::uint8_t,16> const& key128);
+    AES_CTR& set_key192 (std::array<std::uint8_t,24> const& key192);
+    AES_CTR& set_key256 (std::array<std::uint8_t,32> const& key256);
+    // the initial counter block of 16 octets, which seeks to 0.
+    AES_CTR& set_counter (std::string const& a);
+    // the octet offset in the key stream of the next update.
+    AES_CTR& seek (std::uint64_t const offset);
+    std::uint64_t tell (void) const;
+
+    std::string update (std::string::const_iterator s, std::string::const_iterator e);
+    std::string update (std::string const& src);
+    std::string update (octets::view const& src);
+    // writes size octets to dst, which may be the same as src.
+    void update (void const* src, std::size_t size, void* dst);
+    // the same as update, with the whole blocks split by counter ranges
+    // over up to nthread threads, nthread 0 meaning one per hardware thread.
+    void update_parallel (void const* src, std::size_t size, void* dst,
+        std::size_t nthread = 0);
+
+private:
+    AES aes;
+    AES::BLOCK counter0;
+    AES::BLOCK key_stream;
+    std::uint64_t offset;
+    std::uint64_t key_stream_block;
+    bool key_stream_ready;
+
+    void xor_partial (std::uint8_t const* src, std::uint8_t* dst, std::size_t const n);
+};
+
+}//namespace cipher
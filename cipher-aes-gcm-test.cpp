@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <string>
 #include <array>
+#include <vector>
 #include <algorithm>
 #include "cipher-aes-gcm.hpp"
 #include "mime-base16.hpp"
@@ -300,7 +301,7 @@ decode_key256 (std::string const& keyhex)
 int
 main (int argc, char* argv[])
 {
-    test::simple ts (NBLOCK * 4);
+    test::simple ts (NBLOCK * 6 + 3);
 
     for (int i = 0; i < NBLOCK; ++i) {
         cipher::AES_GCM gcm;
@@ -354,5 +355,72 @@ main (int argc, char* argv[])
         ts.ok (gcm.good (), spec[i].name + " decrypt good");
     }
 
+    // decrypt in place from a vector, 7 octets at a time
+    for (int i = 0; i < NBLOCK; ++i) {
+        cipher::AES_GCM gcm;
+        if (spec[i].key.size () == 32) {
+            gcm.set_key128 (decode_key128 (spec[i].key));
+        }
+        else if (spec[i].key.size () == 48) {
+            gcm.set_key192 (decode_key192 (spec[i].key));
+        }
+        else {
+            gcm.set_key256 (decode_key256 (spec[i].key));
+        }
+        std::string const expected_plaintext = decode_hex (spec[i].plaintext);
+        std::string const ciphertext = decode_hex (spec[i].ciphertext);
+        std::vector<std::uint8_t> buf (ciphertext.cbegin (), ciphertext.cend ());
+        gcm.add_authdata (decode_hex (spec[i].authdata));
+        gcm.set_nonce (decode_hex (spec[i].nonce));
+        gcm.set_authtag (decode_hex (spec[i].authtag));
+        gcm.decrypt ();
+        for (std::size_t j = 0; j < buf.size (); j += 7) {
+            std::size_t const n = std::min<std::size_t> (7, buf.size () - j);
+            gcm.update (buf.data () + j, n, buf.data () + j);
+        }
+
+        ts.ok (std::string (buf.cbegin (), buf.cend ()) == expected_plaintext,
+            spec[i].name + " plain text in place");
+        ts.ok (gcm.good (), spec[i].name + " decrypt in place good");
+    }
+
+    // a long text takes the key stream in bulk, which must agree with
+    // openssl aes-128-ctr and with the octet path 7 octets at a time.
+    {
+        std::array<std::uint8_t,16> const key = decode_key128 ("000102030405060708090a0b0c0d0e0f");
+        std::string const nonce = decode_hex ("cafebabefacedbaddecaf888");
+        std::string plaintext (1000, 0);
+        for (std::size_t j = 0; j < plaintext.size (); ++j)
+            plaintext[j] = static_cast<char> (j * 7 + 3);
+        cipher::AES_GCM gcm1;
+        gcm1.set_key128 (key).set_nonce (nonce).encrypt ();
+        std::string const ciphertext = gcm1.update (plaintext);
+        std::string const authtag = gcm1.authtag ();
+        ts.ok (ciphertext.substr (0, 16) == decode_hex ("8a73d6ae9ad1ac35915280d80aa4c58b")
+            && ciphertext.substr (128, 32) == decode_hex (
+                "02351270d6cf9ed14ddbc38ee12655187f4d3be6b7557040e2675bc460c7a758")
+            && ciphertext.substr (960) == decode_hex (
+                "4fb745b4d84cf7a7e4c0ddbd154d235d5c017b3a9285a1621c242b794eea557c"
+                "ae9dc08f402eb50f"),
+            "1000 octets cipher text");
+
+        cipher::AES_GCM gcm2;
+        gcm2.set_key128 (key).set_nonce (nonce).encrypt ();
+        std::string chunked (plaintext.size (), 0);
+        for (std::size_t j = 0; j < plaintext.size (); j += 7) {
+            std::size_t const n = std::min<std::size_t> (7, plaintext.size () - j);
+            gcm2.update (&plaintext[j], n, &chunked[j]);
+        }
+        ts.ok (chunked == ciphertext && gcm2.authtag () == authtag,
+            "1000 octets 7 octets at a time");
+
+        cipher::AES_GCM gcm3;
+        gcm3.set_key128 (key).set_nonce (nonce).set_authtag (authtag).decrypt ();
+        std::string buf (ciphertext);
+        gcm3.update (&buf[0], 5, &buf[0]);
+        gcm3.update (&buf[5], buf.size () - 5, &buf[5]);
+        ts.ok (buf == plaintext && gcm3.good (), "1000 octets decrypt in place");
+    }
+
     return ts.done_testing ();
 }
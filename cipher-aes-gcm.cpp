@@ -125,32 +125,61 @@ AES_GCM::good (void)
     return ok;
 }
 
-std::string
-AES_GCM::update (std::string::const_iterator s, std::string::const_iterator e)
+void
+AES_GCM::update (void const* src, std::size_t size, void* dst)
 {
     if (ENCRYPT != state && DECRYPT != state)
         throw std::runtime_error ("update() decends encrypt() or decrypt().");
-    if (s >= e)
-        return "";
+    if (0 == size)
+        return;
     if (DECRYPT == state)
-        ghash.add (s, e);
-    std::string dst;
-    while (s < e) {
-        dst.push_back (static_cast<std::uint8_t> (*s++) ^ key_stream[pos]);
+        ghash.add (src, size);
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    std::size_t i = 0;
+    while (i < size) {
+        if (0 == pos && size - i >= 2 * AES::BLOCKSIZE) {
+            // the first block takes the current key stream, and the
+            // rest of the whole blocks that of the counters after it.
+            std::size_t const nblock = (size - i) / AES::BLOCKSIZE;
+            for (int j = 0; j < AES::BLOCKSIZE; ++j)
+                d[i + j] = s[i + j] ^ key_stream[j];
+            AES::step_counter (AES::COUNTER_INC128, counter);
+            aes.xor_counter_blocks (AES::COUNTER_INC128, counter,
+                s + i + AES::BLOCKSIZE, d + i + AES::BLOCKSIZE, nblock - 1);
+            aes.encrypt (counter, key_stream);
+            i += nblock * AES::BLOCKSIZE;
+            continue;
+        }
+        d[i] = s[i] ^ key_stream[pos];
+        ++i;
         if (++pos >= key_stream.size ()) {
             increment_counter ();
             pos = 0;
         }
     }
     if (ENCRYPT == state)
-        ghash.add (dst.cbegin (), dst.cend ());
+        ghash.add (dst, size);
+}
+
+std::string
+AES_GCM::update (octets::view const& src)
+{
+    std::string dst (src.size (), 0);
+    update (src.data (), src.size (), &dst[0]);
     return std::move (dst);
 }
 
+std::string
+AES_GCM::update (std::string::const_iterator s, std::string::const_iterator e)
+{
+    return update (octets::view (s, e));
+}
+
 std::string
 AES_GCM::update (std::string const& src)
 {
-    return update (src.cbegin (), src.cend ());
+    return update (octets::view (src));
 }
 
 void
@@ -175,12 +204,7 @@ AES_GCM::reset_counter (void)
 void
 AES_GCM::increment_counter (void)
 {
-    // constant-time increment
-    AES::BLOCK::value_type carry = 1U;
-    for (int i = counter.size () - 1; i >= 0; --i) {
-        counter[i] += carry;
-        carry = counter[i] < carry ? 1U : 0;
-    }
+    AES::step_counter (AES::COUNTER_INC128, counter);
     aes.encrypt (counter, key_stream);
 }
 
@@ -4,6 +4,7 @@
 #include <list>
 #include <string>
 #include <array>
+#include "octets-view.hpp"
 #include "digest-ghash.hpp"
 #include "cipher-aes.hpp"
 
@@ -28,6 +29,9 @@ public:
 
     std::string update (std::string::const_iterator s, std::string::const_iterator e);
     std::string update (std::string const& src);
+    std::string update (octets::view const& src);
+    // writes size octets to dst, which may be the same as src.
+    void update (void const* src, std::size_t size, void* dst);
 
 private:
     enum { INIT, DECRYPT, ENCRYPT, FINAL };
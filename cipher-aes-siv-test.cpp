@@ -167,6 +167,52 @@ test_a2_decrypt (test::simple& ts)
     ts.ok (expected_plaintext == got_plaintext, "nonce-based decrypt plaintext");
 }
 
+// a long plaintext takes the key stream in bulk, which must agree
+// with openssl aes-128-ctr on the masked SIV and with the octet path.
+void
+test_long (test::simple& ts)
+{
+    std::array<std::uint8_t,32> input_key = decode_key256 (
+        "fffefdfc fbfaf9f8 f7f6f5f4 f3f2f1f0"
+        "f0f1f2f3 f4f5f6f7 f8f9fafb fcfdfeff");
+    std::string input_plaintext (1000, 0);
+    for (std::size_t i = 0; i < input_plaintext.size (); ++i)
+        input_plaintext[i] = static_cast<char> (i * 7 + 3);
+    std::string const expected_authtag = decode_hex (
+        "b8085b55 349a3182 9d8928c9 bad98c1c");
+    std::string const expected_head = decode_hex (
+        "5e3f5f16 b8456eb7 d2af06ad fe1eb665"
+        "249febb6 1a8219e2 6450dc2f c561c8b9");
+    std::string const expected_tail = decode_hex (
+        "4caa5b84 685235be 825e06a1 2adc7efd"
+        "6abc75b6 2b11b42a 68e96d26 f00f1381"
+        "ef46120f cc4cc79e");
+
+    cipher::AES_SIV aes_siv;
+    aes_siv.set_key256 (input_key);
+    aes_siv.add (input_plaintext);
+    aes_siv.encrypt ();
+    std::string got_ciphertext = aes_siv.update (input_plaintext);
+    std::string got_authtag = aes_siv.authtag ();
+
+    ts.ok (expected_authtag == got_authtag, "1000 octets encrypt authtag");
+    ts.ok (expected_head == got_ciphertext.substr (0, 32)
+        && expected_tail == got_ciphertext.substr (960),
+        "1000 octets encrypt ciphertext");
+
+    cipher::AES_SIV aes_siv2;
+    aes_siv2.set_key256 (input_key);
+    aes_siv2.set_authtag (got_authtag);
+    aes_siv2.decrypt ();
+    std::string got_plaintext (got_ciphertext);
+    for (std::size_t i = 0; i < got_plaintext.size (); i += 7) {
+        std::size_t const n = std::min<std::size_t> (7, got_plaintext.size () - i);
+        aes_siv2.update (&got_plaintext[i], n, &got_plaintext[i]);
+    }
+    ts.ok (aes_siv2.good (), "1000 octets decrypt 7 octets at a time good");
+    ts.ok (input_plaintext == got_plaintext, "1000 octets decrypt 7 octets at a time plaintext");
+}
+
 int
 main (int argc, char* argv[])
 {
@@ -176,6 +222,7 @@ main (int argc, char* argv[])
     test_a1_decrypt (ts);
     test_a2_encrypt (ts);
     test_a2_decrypt (ts);
+    test_long (ts);
 
     return ts.done_testing ();
 }
@@ -91,18 +91,31 @@ AES_SIV::add_authdata (std::string const& a)
 AES_SIV&
 AES_SIV::add (std::string const& a)
 {
-    return add (a.cbegin (), a.cend ());
+    return add (a.data (), a.size ());
 }
 
 AES_SIV&
 AES_SIV::add (std::string::const_iterator s, std::string::const_iterator e)
+{
+    return add (octets::view (s, e));
+}
+
+AES_SIV&
+AES_SIV::add (octets::view const& a)
+{
+    return add (a.data (), a.size ());
+}
+
+AES_SIV&
+AES_SIV::add (void const* data, std::size_t size)
 {
     if (INIT == state || FINAL == state)
         init_tag ();
     else if (ENCRYPT == state || DECRYPT == state)
         throw std::runtime_error ("cannot add () at update ().");
     state = UPDATECMAC;
-    update_cmac (s, e);
+    std::uint8_t const* const s = static_cast<std::uint8_t const*> (data);
+    update_cmac (s, s + size);
     return *this;
 }
 
@@ -128,31 +141,60 @@ AES_SIV::decrypt (void)
     return *this;
 }
 
-std::string
-AES_SIV::update (std::string::const_iterator s, std::string::const_iterator e)
+void
+AES_SIV::update (void const* src, std::size_t size, void* dst)
 {
     if (ENCRYPT != state && DECRYPT != state)
         throw std::runtime_error ("update() decends encrypt() or decrypt().");
-    if (s >= e)
-        return "";
-    std::string dst;
-    while (s < e) {
-        dst.push_back (static_cast<std::uint8_t> (*s++) ^ key_stream[pos]);
+    if (0 == size)
+        return;
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    std::size_t i = 0;
+    while (i < size) {
+        if (0 == pos && size - i >= 2 * AES::BLOCKSIZE) {
+            // the first block takes the current key stream, and the
+            // rest of the whole blocks that of the counters after it.
+            std::size_t const nblock = (size - i) / AES::BLOCKSIZE;
+            for (int j = 0; j < AES::BLOCKSIZE; ++j)
+                d[i + j] = s[i + j] ^ key_stream[j];
+            AES::step_counter (AES::COUNTER_INC64, counter);
+            aes.xor_counter_blocks (AES::COUNTER_INC64, counter,
+                s + i + AES::BLOCKSIZE, d + i + AES::BLOCKSIZE, nblock - 1);
+            aes.encrypt (counter, key_stream);
+            i += nblock * AES::BLOCKSIZE;
+            continue;
+        }
+        d[i] = s[i] ^ key_stream[pos];
+        ++i;
         if (++pos >= key_stream.size ()) {
             increment_counter ();
             pos = 0;
         }
     }
     if (DECRYPT == state) {
-        update_cmac (dst.cbegin (), dst.cend ());
+        update_cmac (d, d + size);
     }
+}
+
+std::string
+AES_SIV::update (octets::view const& src)
+{
+    std::string dst (src.size (), 0);
+    update (src.data (), src.size (), &dst[0]);
     return std::move (dst);
 }
 
+std::string
+AES_SIV::update (std::string::const_iterator s, std::string::const_iterator e)
+{
+    return update (octets::view (s, e));
+}
+
 std::string
 AES_SIV::update (std::string const& src)
 {
-    return update (src.cbegin (), src.cend ());
+    return update (octets::view (src));
 }
 
 std::string
@@ -240,7 +282,7 @@ AES_SIV::init_tag (void)
 // push back s ... e.
 // ensure: the tail is filled. the its size is m. 
 void
-AES_SIV::splice_tail (std::string::const_iterator s, std::string::const_iterator e)
+AES_SIV::splice_tail (std::uint8_t const* s, std::uint8_t const* e)
 {
     std::size_t const m = tail.size ();
     std::size_t const n1 = tailcount < m ? tailcount : m;
@@ -248,7 +290,14 @@ AES_SIV::splice_tail (std::string::const_iterator s, std::string::const_iterator
     std::size_t const i = tailcount < m ? 0 : tailcount - m;
 
     std::size_t const n0 = n1 + n2 - m;
-    if (n1 < m || i + n2 <= n1) {
+    if (n1 < m) {
+        // pop{tail[0...n0]} tail[n0...n1] push{str(s...e)}
+        if (n0 > 0)
+            aes_cmac.add (tail.cbegin (), tail.cbegin () + n0);
+        std::copy (s, s + (m - n1), tail.begin () + n1);
+        std::copy (s + (m - n1), e, tail.begin ());
+    }
+    else if (i + n2 <= n1) {
         // pop{tail[i...i+n0]} tail[i+n0...m] tail[0...i] push{str(s...e)}
         if (n0 > 0)
             aes_cmac.add (tail.cbegin () + i, tail.cbegin () + i + n0);
@@ -277,7 +326,7 @@ AES_SIV::splice_tail (std::string::const_iterator s, std::string::const_iterator
 // assign tail with e - m ... e.
 // ensure: the tail is filled. the its size is m. 
 void
-AES_SIV::replace_tail (std::string::const_iterator s, std::string::const_iterator e)
+AES_SIV::replace_tail (std::uint8_t const* s, std::uint8_t const* e)
 {
     std::size_t const m = tail.size ();
     std::size_t const n1 = tailcount < m ? tailcount : m;
@@ -293,13 +342,13 @@ AES_SIV::replace_tail (std::string::const_iterator s, std::string::const_iterato
         aes_cmac.add (tail.cbegin (), tail.cbegin () + i);
     }
     if (m < n2)
-        aes_cmac.add (s, e - m);
+        aes_cmac.add (s, n2 - m);
     tail.assign (e - m, e);
     tailcount = m;
 }
 
 void
-AES_SIV::update_cmac (std::string::const_iterator s, std::string::const_iterator e)
+AES_SIV::update_cmac (std::uint8_t const* s, std::uint8_t const* e)
 {
     if (s >= e)
         return;
@@ -386,13 +435,7 @@ AES_SIV::preset_counter (std::string const& v)
 void
 AES_SIV::increment_counter (void)
 {
-    // 64-bit constant-time increment
-    int const d = counter.size () - 8;
-    AES::BLOCK::value_type carry = 1U;
-    for (int i = d + 7; i >= d; --i) {
-        counter[i] += carry;
-        carry = counter[i] < carry ? 1U : 0;
-    }
+    AES::step_counter (AES::COUNTER_INC64, counter);
     aes.encrypt (counter, key_stream);
 }
 
@@ -4,6 +4,7 @@
 #include <list>
 #include <string>
 #include <array>
+#include "octets-view.hpp"
 #include "digest-aes-cmac.hpp"
 #include "cipher-aes.hpp"
 
@@ -19,6 +20,8 @@ public:
 
     AES_SIV& add (std::string const& a);
     AES_SIV& add (std::string::const_iterator s, std::string::const_iterator e);
+    AES_SIV& add (octets::view const& a);
+    AES_SIV& add (void const* data, std::size_t size);
     AES_SIV& encrypt (void);
     std::string authtag (void);
 
@@ -28,6 +31,9 @@ public:
 
     std::string update (std::string::const_iterator s, std::string::const_iterator e);
     std::string update (std::string const& src);
+    std::string update (octets::view const& src);
+    // writes size octets to dst, which may be the same as src.
+    void update (void const* src, std::size_t size, void* dst);
 
 private:
     enum { INIT, UPDATECMAC, DECRYPT, ENCRYPT, FINAL };
@@ -46,9 +52,9 @@ private:
     int pos;
 
     void init_tag (void);
-    void splice_tail (std::string::const_iterator s, std::string::const_iterator e);
-    void replace_tail (std::string::const_iterator s, std::string::const_iterator e);
-    void update_cmac (std::string::const_iterator s, std::string::const_iterator e);
+    void splice_tail (std::uint8_t const* s, std::uint8_t const* e);
+    void replace_tail (std::uint8_t const* s, std::uint8_t const* e);
+    void update_cmac (std::uint8_t const* s, std::uint8_t const* e);
     void final_tag (void);
     void gfadd (std::string& d, std::string& a, int j, int const n);
     void gftwice (std::string& s);
@@ -1,5 +1,6 @@
 #include <cstdlib>
 #include <cstdint>
+#include <algorithm>
 #include "cipher-aes.hpp"
 #include "taptests.hpp"
 
@@ -109,14 +110,171 @@ test_key256 (test::simple& t)
     }
 }
 
+// encrypt_blocks and decrypt_blocks against encrypt and decrypt one
+// block at a time on the selected engine.
+// 37 blocks fill the widest groups of the engines and leave a partial one.
+void
+test_blocks (test::simple& t)
+{
+    enum { NBLOCK = 37 };
+    std::array<std::uint8_t,32> key256;
+    for (std::size_t i = 0; i < key256.size (); ++i)
+        key256[i] = static_cast<std::uint8_t> (i * 37 + 11);
+    AES_BLOCK plain[NBLOCK], secret[NBLOCK], buf[NBLOCK];
+    for (std::size_t k = 0; k < NBLOCK; ++k)
+        for (std::size_t i = 0; i < plain[k].size (); ++i)
+            plain[k][i] = static_cast<std::uint8_t> (k * 16 + i);
+    cipher::AES aes;
+    aes.set_encrypt_key256 (key256);
+    for (std::size_t k = 0; k < NBLOCK; ++k)
+        aes.encrypt (plain[k], secret[k]);
+    std::copy (plain, plain + NBLOCK, buf);
+    aes.encrypt_blocks (buf, buf, NBLOCK);
+    bool ok = std::equal (buf, buf + NBLOCK, secret);
+    aes.set_decrypt_key256 (key256);
+    aes.decrypt_blocks (buf, buf, NBLOCK);
+    t.ok (ok && std::equal (buf, buf + NBLOCK, plain), "encrypt_blocks and decrypt_blocks");
+}
+
+// the counters of xor_counter_blocks against step_counter one block at
+// a time. both start near the wrap of their width, so that the carry
+// goes into the upper 64 bits only for COUNTER_INC128.
+bool
+same_counter_blocks (cipher::AES& aes, cipher::AES::counter_inc const inc, AES_BLOCK ctr)
+{
+    enum { NBLOCK = 37 };
+    std::uint8_t src[NBLOCK * 16], dst[NBLOCK * 16];
+    for (std::size_t i = 0; i < sizeof (src); ++i)
+        src[i] = static_cast<std::uint8_t> (i * 7 + 3);
+    AES_BLOCK bulk = ctr;
+    aes.xor_counter_blocks (inc, bulk, src, dst, NBLOCK);
+    bool ok = true;
+    for (std::size_t k = 0; k < NBLOCK; ++k) {
+        AES_BLOCK ks;
+        aes.encrypt (ctr, ks);
+        cipher::AES::step_counter (inc, ctr);
+        for (std::size_t j = 0; j < ks.size (); ++j)
+            ok = ok && dst[k * 16 + j] == (src[k * 16 + j] ^ ks[j]);
+    }
+    return ok && bulk == ctr;
+}
+
+void
+test_counter_blocks (test::simple& t)
+{
+    std::array<std::uint8_t,16> key128;
+    for (std::size_t i = 0; i < key128.size (); ++i)
+        key128[i] = static_cast<std::uint8_t> (i * 29 + 5);
+    cipher::AES aes;
+    aes.set_encrypt_key128 (key128);
+    AES_BLOCK ctr;
+    ctr.fill (0xff);
+    ctr[0] = 0x12;
+    ctr[15] = 0xf0;
+    AES_BLOCK const wrapped128 {{0x13, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x15}};
+    AES_BLOCK const wrapped64 {{0x12, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0, 0, 0, 0, 0, 0, 0, 0x15}};
+    AES_BLOCK a = ctr, b = ctr;
+    std::uint8_t buf[37 * 16] = {0};
+    aes.xor_counter_blocks (cipher::AES::COUNTER_INC128, a, buf, buf, 37);
+    aes.xor_counter_blocks (cipher::AES::COUNTER_INC64, b, buf, buf, 37);
+    t.ok (a == wrapped128 && b == wrapped64
+        && same_counter_blocks (aes, cipher::AES::COUNTER_INC128, ctr)
+        && same_counter_blocks (aes, cipher::AES::COUNTER_INC64, ctr),
+        "xor_counter_blocks steps the counter over 128 and 64 bits");
+}
+
+// a chain of blocks through both engines, keys scheduled by each
+template<std::size_t N>
+bool
+same_on_engines (cipher::AES::engine_type const e1, cipher::AES::engine_type const e2,
+    std::array<std::uint8_t,N> const& key,
+    void (cipher::AES::*set_encrypt_key) (std::array<std::uint8_t,N> const&),
+    void (cipher::AES::*set_decrypt_key) (std::array<std::uint8_t,N> const&))
+{
+    cipher::AES one, two;
+    AES_BLOCK a {{0}}, b {{0}}, c, d;
+    cipher::AES::select_engine (e1);
+    (one.*set_encrypt_key) (key);
+    cipher::AES::select_engine (e2);
+    (two.*set_encrypt_key) (key);
+    for (int i = 0; i < 1000; ++i) {
+        cipher::AES::select_engine (e1);
+        two.encrypt (a, c);
+        cipher::AES::select_engine (e2);
+        one.encrypt (b, d);
+        a = c;
+        b = d;
+    }
+    cipher::AES::select_engine (e1);
+    (one.*set_decrypt_key) (key);
+    cipher::AES::select_engine (e2);
+    (two.*set_decrypt_key) (key);
+    for (int i = 0; i < 1000; ++i) {
+        cipher::AES::select_engine (e1);
+        two.decrypt (a, c);
+        cipher::AES::select_engine (e2);
+        one.decrypt (b, d);
+        a = c;
+        b = d;
+    }
+    return a == b && a == AES_BLOCK {{0}};
+}
+
+void
+test_engines (test::simple& t, cipher::AES::engine_type const e, char const* name)
+{
+    std::array<std::uint8_t,16> key128;
+    std::array<std::uint8_t,24> key192;
+    std::array<std::uint8_t,32> key256;
+    for (std::size_t i = 0; i < key256.size (); ++i) {
+        key256[i] = static_cast<std::uint8_t> (i * 37 + 11);
+        if (i < key192.size ())
+            key192[i] = key256[i] ^ 0x5a;
+        if (i < key128.size ())
+            key128[i] = key256[i] ^ 0xa5;
+    }
+    cipher::AES::engine_type const p = cipher::AES::ENGINE_PORTABLE;
+    t.ok (same_on_engines (p, e, key128, &cipher::AES::set_encrypt_key128, &cipher::AES::set_decrypt_key128)
+        && same_on_engines (p, e, key192, &cipher::AES::set_encrypt_key192, &cipher::AES::set_decrypt_key192)
+        && same_on_engines (p, e, key256, &cipher::AES::set_encrypt_key256, &cipher::AES::set_decrypt_key256),
+        name);
+    cipher::AES::select_engine (cipher::AES::ENGINE_AUTO);
+}
+
 }//namespace
 
 int
 main ()
 {
-    test::simple t (6);
+    test::simple t (26);
+    cipher::AES::select_engine (cipher::AES::ENGINE_PORTABLE);
     test_key128 (t);
     test_key192 (t);
     test_key256 (t);
+    test_blocks (t);
+    test_counter_blocks (t);
+    cipher::AES::select_engine (cipher::AES::ENGINE_BITSLICE);
+    test_key128 (t);
+    test_key192 (t);
+    test_key256 (t);
+    test_blocks (t);
+    test_counter_blocks (t);
+    if (! cipher::AES::select_engine (cipher::AES::ENGINE_AESNI)) {
+        t.diag ("aes-ni engine is not available, testing the portable one.");
+        cipher::AES::select_engine (cipher::AES::ENGINE_PORTABLE);
+    }
+    test_key128 (t);
+    test_key192 (t);
+    test_key256 (t);
+    test_blocks (t);
+    test_counter_blocks (t);
+    if (cipher::AES::ENGINE_AESNI != cipher::AES::engine ()) {
+        t.skip ();
+        t.ok (true, "aes-ni engine is not available");
+    }
+    else
+        test_engines (t, cipher::AES::ENGINE_AESNI, "portable and aes-ni engines agree");
+    test_engines (t, cipher::AES::ENGINE_BITSLICE, "portable and bitsliced engines agree");
     return t.done_testing ();
 }
@@ -0,0 +1,204 @@
+#include <cstdint>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "cipher-aes-xts.hpp"
+#include "mime-base16.hpp"
+#include "taptests.hpp"
+
+std::string
+decode_hex (std::string const& hex)
+{
+    std::string octets;
+    mime::decode_hex (hex, octets);
+    return octets;
+}
+
+template<std::size_t N>
+std::array<std::uint8_t,N>
+decode_key (std::string const& keyhex)
+{
+    std::string const octets = decode_hex (keyhex);
+    std::array<std::uint8_t,N> key {{0}};
+    std::copy (octets.cbegin (), octets.cend (), key.begin ());
+    return key;
+}
+
+cipher::AES::BLOCK
+sector_tweak (std::uint64_t const sector)
+{
+    cipher::AES::BLOCK tweak {{0}};
+    for (int i = 0; i < 8; ++i)
+        tweak[i] = static_cast<std::uint8_t> (sector >> (i * 8));
+    return tweak;
+}
+
+std::string
+long_text (std::size_t const n)
+{
+    std::string plaintext (n, 0);
+    for (std::size_t i = 0; i < n; ++i)
+        plaintext[i] = static_cast<char> (i * 7 + 3);
+    return plaintext;
+}
+
+std::string
+encrypt (cipher::AES_XTS& xts, std::uint64_t const sector, std::string const& plaintext)
+{
+    std::string ciphertext (plaintext.size (), 0);
+    xts.encrypt (sector_tweak (sector), plaintext.data (), plaintext.size (), &ciphertext[0]);
+    return ciphertext;
+}
+
+std::string
+decrypt (cipher::AES_XTS& xts, std::uint64_t const sector, std::string const& ciphertext)
+{
+    std::string plaintext (ciphertext.size (), 0);
+    xts.decrypt (sector_tweak (sector), ciphertext.data (), ciphertext.size (), &plaintext[0]);
+    return plaintext;
+}
+
+// IEEE 1619-2007 Annex B XTS-AES test vectors 1, 2 and 10
+void
+test_ieee1619 (test::simple& ts)
+{
+    // vector 1 has Key1 equal to Key2, which SP 800-38E rejects.
+    cipher::AES_XTS xts1;
+    bool thrown1 = false;
+    try {
+        xts1.set_key256 (decode_key<32> (
+            "00000000000000000000000000000000"
+            "00000000000000000000000000000000"));
+    }
+    catch (std::runtime_error const&) {
+        thrown1 = true;
+    }
+    ts.ok (thrown1, "Vector 1 XTS-AES-128 identical keys throw");
+
+    cipher::AES_XTS xts2;
+    xts2.set_key256 (decode_key<32> (
+        "11111111111111111111111111111111"
+        "22222222222222222222222222222222"));
+    std::string const ciphertext2 = encrypt (xts2, 0x3333333333ULL, std::string (32, 0x44));
+    ts.ok (ciphertext2 == decode_hex (
+        "c454185e6a16936e39334038acef838b"
+        "fb186fff7480adc4289382ecd6d394f0"), "Vector 2 XTS-AES-128 encrypt");
+    ts.ok (decrypt (xts2, 0x3333333333ULL, ciphertext2) == std::string (32, 0x44),
+        "Vector 2 XTS-AES-128 decrypt");
+
+    cipher::AES_XTS xts10;
+    xts10.set_key512 (decode_key<64> (
+        "27182818284590452353602874713526"
+        "62497757247093699959574966967627"
+        "31415926535897932384626433832795"
+        "02884197169399375105820974944592"));
+    std::string plaintext10 (512, 0);
+    for (std::size_t i = 0; i < plaintext10.size (); ++i)
+        plaintext10[i] = static_cast<char> (i);
+    std::string const ciphertext10 = encrypt (xts10, 0xff, plaintext10);
+    ts.ok (ciphertext10.substr (0, 32) == decode_hex (
+        "1c3b3a102f770386e4836c99e370cf9b"
+        "ea00803f5e482357a4ae12d414a3e63b"), "Vector 10 XTS-AES-256 encrypt");
+    ts.ok (decrypt (xts10, 0xff, ciphertext10) == plaintext10, "Vector 10 XTS-AES-256 decrypt");
+}
+
+// the ciphertext stealing as openssl aes-128-xts does.
+void
+test_stealing (test::simple& ts)
+{
+    cipher::AES_XTS xts;
+    xts.set_key256 (decode_key<32> (
+        "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0"
+        "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0"));
+    std::string plaintext (31, 0);
+    for (std::size_t i = 0; i < plaintext.size (); ++i)
+        plaintext[i] = static_cast<char> (i);
+    std::uint64_t const sector = 0x9a78563412ULL;
+    std::string const ciphertext17 = encrypt (xts, sector, plaintext.substr (0, 17));
+    ts.ok (ciphertext17 == decode_hex ("641610679dcbf92e505c41333fb06c2a95"),
+        "17 octets encrypt");
+    ts.ok (decrypt (xts, sector, ciphertext17) == plaintext.substr (0, 17), "17 octets decrypt");
+    std::string const ciphertext31 = encrypt (xts, sector, plaintext);
+    ts.ok (ciphertext31 == decode_hex ("c03f4c6088fcf14c308aa39f7938980995c871f6522469cc737109594ab0fe"),
+        "31 octets encrypt");
+    ts.ok (decrypt (xts, sector, ciphertext31) == plaintext, "31 octets decrypt");
+
+    cipher::AES_XTS xts5;
+    xts5.set_key256 (decode_key<32> (
+        "000102030405060708090a0b0c0d0e0f"
+        "f0e0d0c0b0a090807060504030201000"));
+    std::string const plaintext5 = long_text (4101);
+    std::string const ciphertext5 = encrypt (xts5, 5, plaintext5);
+    ts.ok (ciphertext5.substr (0, 16) == decode_hex ("f2d7783e74383e4ea24119d3621cc00e")
+        && ciphertext5.substr (4080) == decode_hex (
+        "2621cca86adfb5e7fd2ac2ae868db62bee6a731ba5"), "4101 octets encrypt");
+    std::string buf (ciphertext5);
+    xts5.decrypt (sector_tweak (5), &buf[0], buf.size (), &buf[0]);
+    ts.ok (buf == plaintext5, "4101 octets decrypt in place");
+}
+
+void
+test_sectors (test::simple& ts)
+{
+    cipher::AES_XTS xts;
+    xts.set_key256 (decode_key<32> (
+        "000102030405060708090a0b0c0d0e0f"
+        "f0e0d0c0b0a090807060504030201000"));
+
+    std::string const plaintext = long_text (4096 * 3);
+    std::string ciphertext (plaintext.size (), 0);
+    xts.encrypt_sectors (0xfffffffeULL, 4096, plaintext.data (), 3, &ciphertext[0]);
+    bool ok = true;
+    for (std::size_t i = 0; i < 3; ++i)
+        ok = ok && ciphertext.substr (i * 4096, 4096)
+            == encrypt (xts, 0xfffffffeULL + i, plaintext.substr (i * 4096, 4096));
+    ts.ok (ok && ciphertext.substr (8192, 16) == decode_hex ("95ae1916369169808e80e5e6a983bd9d")
+        && ciphertext.substr (12272) == decode_hex ("cf8b8d2254eb54409b3d9cc8cba7f527"),
+        "encrypt_sectors 4096 octets");
+    std::string buf (ciphertext);
+    xts.decrypt_sectors (0xfffffffeULL, 4096, &buf[0], 3, &buf[0]);
+    ts.ok (buf == plaintext, "decrypt_sectors in place");
+
+    std::string const plaintext520 = long_text (520 * 20);
+    std::string ciphertext520 (plaintext520.size (), 0);
+    xts.encrypt_sectors (7, 520, plaintext520.data (), 20, &ciphertext520[0]);
+    ok = true;
+    for (std::size_t i = 0; i < 20; ++i)
+        ok = ok && ciphertext520.substr (i * 520, 520)
+            == encrypt (xts, 7 + i, plaintext520.substr (i * 520, 520));
+    ts.ok (ok && ciphertext520.substr (520 * 20 - 24) == decode_hex (
+        "7ebf98bc837e9e63523b4a0fbb3df826e37949716f17d4b7"), "encrypt_sectors 520 octets");
+    std::string got520 (plaintext520.size (), 0);
+    xts.decrypt_sectors (7, 520, ciphertext520.data (), 20, &got520[0]);
+    ts.ok (got520 == plaintext520, "decrypt_sectors 520 octets");
+}
+
+void
+test_short_unit (test::simple& ts)
+{
+    cipher::AES_XTS xts;
+    xts.set_key256 (decode_key<32> (
+        "000102030405060708090a0b0c0d0e0f"
+        "f0e0d0c0b0a090807060504030201000"));
+    std::string buf (15, 0);
+    bool thrown = false;
+    try {
+        xts.encrypt (sector_tweak (0), buf.data (), buf.size (), &buf[0]);
+    }
+    catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    ts.ok (thrown, "data unit must be at least 16 octets");
+}
+
+int
+main (int argc, char* argv[])
+{
+    test::simple ts (16);
+    test_ieee1619 (ts);
+    test_stealing (ts);
+    test_sectors (ts);
+    test_short_unit (ts);
+    return ts.done_testing ();
+}
@@ -0,0 +1,280 @@
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "cipher-aes-xts.hpp"
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+enum { NBULK = 16 };
+
+// multiplies the tweak by the primitive element alpha of GF(2^128),
+// whose octets are in little-endian, without a branch.
+static inline void
+mul_alpha (AES::BLOCK& t)
+{
+    unsigned int const carry = t[15] >> 7;
+    for (int i = AES::BLOCKSIZE - 1; i > 0; --i)
+        t[i] = static_cast<std::uint8_t> ((t[i] << 1) | (t[i - 1] >> 7));
+    t[0] = static_cast<std::uint8_t> ((t[0] << 1) ^ (0x87U & (0U - carry)));
+}
+
+// the running tweak of crypt_blocks. on a little-endian host it is a
+// vector of two 64-bit lanes, which steps in a register and goes to
+// memory in a single store. it takes only lane subscripts and
+// operations between vectors, which GCC and clang both have.
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+typedef std::uint64_t tweak_type __attribute__ ((vector_size (16)));
+
+static inline void
+mul_alpha (tweak_type& t)
+{
+    tweak_type const carry = {(0 - (t[1] >> 63)) & 0x87, t[0] >> 63};
+    t = (t + t) ^ carry;
+}
+
+static inline tweak_type
+load_tweak (AES::BLOCK const& b)
+{
+    tweak_type t;
+    std::memcpy (&t, b.data (), sizeof (t));
+    return t;
+}
+
+static inline void
+store_tweak (tweak_type const& t, AES::BLOCK& b)
+{
+    std::memcpy (b.data (), &t, sizeof (t));
+}
+#else
+typedef AES::BLOCK tweak_type;
+
+static inline tweak_type
+load_tweak (AES::BLOCK const& b)
+{
+    return b;
+}
+
+static inline void
+store_tweak (tweak_type const& t, AES::BLOCK& b)
+{
+    b = t;
+}
+#endif
+
+static inline void
+check_unit_size (std::size_t const size)
+{
+    if (size < AES::BLOCKSIZE)
+        throw std::runtime_error ("xts data unit must be at least 16 octets.");
+}
+
+template<std::size_t N>
+static inline void
+check_key_halves (std::array<std::uint8_t,N> const& key)
+{
+    if (std::equal (key.cbegin (), key.cbegin () + N / 2, key.cbegin () + N / 2))
+        throw std::runtime_error ("xts key1 and key2 must differ.");
+}
+
+static inline void
+sector_tweak (std::uint64_t const sector, AES::BLOCK& t)
+{
+    for (int i = 0; i < AES::BLOCKSIZE; ++i)
+        t[i] = i < 8 ? static_cast<std::uint8_t> (sector >> (i * 8)) : 0;
+}
+
+AES_XTS::AES_XTS (void) : aes1 (), aes2 ()
+{
+}
+
+AES_XTS&
+AES_XTS::set_key256 (std::array<std::uint8_t,32> const& key256)
+{
+    check_key_halves (key256);
+    std::array<std::uint8_t,16> key1, key2;
+    std::copy (key256.cbegin (), key256.cbegin () + 16, key1.begin ());
+    std::copy (key256.cbegin () + 16, key256.cend (), key2.begin ());
+    aes1.set_encrypt_key128 (key1);
+    aes1.set_decrypt_key128 (key1);
+    aes2.set_encrypt_key128 (key2);
+    return *this;
+}
+
+AES_XTS&
+AES_XTS::set_key512 (std::array<std::uint8_t,64> const& key512)
+{
+    check_key_halves (key512);
+    std::array<std::uint8_t,32> key1, key2;
+    std::copy (key512.cbegin (), key512.cbegin () + 32, key1.begin ());
+    std::copy (key512.cbegin () + 32, key512.cend (), key2.begin ());
+    aes1.set_encrypt_key256 (key1);
+    aes1.set_decrypt_key256 (key1);
+    aes2.set_encrypt_key256 (key2);
+    return *this;
+}
+
+void
+AES_XTS::encrypt (AES::BLOCK const& tweak, void const* src, std::size_t const size, void* dst)
+{
+    check_unit_size (size);
+    AES::BLOCK t;
+    aes2.encrypt (tweak, t);
+    crypt_unit (false, t, static_cast<std::uint8_t const*> (src), size,
+        static_cast<std::uint8_t*> (dst));
+}
+
+void
+AES_XTS::decrypt (AES::BLOCK const& tweak, void const* src, std::size_t const size, void* dst)
+{
+    check_unit_size (size);
+    AES::BLOCK t;
+    aes2.encrypt (tweak, t);
+    crypt_unit (true, t, static_cast<std::uint8_t const*> (src), size,
+        static_cast<std::uint8_t*> (dst));
+}
+
+void
+AES_XTS::encrypt_sectors (std::uint64_t const sector, std::size_t const sector_size,
+    void const* src, std::size_t const nsector, void* dst)
+{
+    crypt_sectors (false, sector, sector_size, static_cast<std::uint8_t const*> (src),
+        nsector, static_cast<std::uint8_t*> (dst));
+}
+
+void
+AES_XTS::decrypt_sectors (std::uint64_t const sector, std::size_t const sector_size,
+    void const* src, std::size_t const nsector, void* dst)
+{
+    crypt_sectors (true, sector, sector_size, static_cast<std::uint8_t const*> (src),
+        nsector, static_cast<std::uint8_t*> (dst));
+}
+
+// the tweaks of NBULK sectors at a time go through Key2 together.
+void
+AES_XTS::crypt_sectors (bool const decrypting, std::uint64_t const sector,
+    std::size_t const sector_size, std::uint8_t const* src, std::size_t const nsector,
+    std::uint8_t* dst)
+{
+    check_unit_size (sector_size);
+    AES::BLOCK t[NBULK];
+    for (std::size_t i = 0; i < nsector; i += NBULK) {
+        std::size_t const m = std::min<std::size_t> (NBULK, nsector - i);
+        for (std::size_t k = 0; k < m; ++k)
+            sector_tweak (sector + i + k, t[k]);
+        aes2.encrypt_blocks (t, t, m);
+        for (std::size_t k = 0; k < m; ++k)
+            crypt_unit (decrypting, t[k], src + (i + k) * sector_size, sector_size,
+                dst + (i + k) * sector_size);
+    }
+}
+
+// whole blocks with the tweaks from t, which goes on past them.
+// NBULK blocks at a time are masked, run through Key1 by
+// encrypt_blocks or decrypt_blocks, and masked again.
+void
+AES_XTS::crypt_blocks (bool const decrypting, AES::BLOCK& t,
+    std::uint8_t const* src, std::uint8_t* dst, std::size_t nblock)
+{
+    tweak_type x = load_tweak (t);
+    AES::BLOCK tw[NBULK];
+    AES::BLOCK buf[NBULK];
+    while (nblock > 0) {
+        std::size_t const m = std::min<std::size_t> (NBULK, nblock);
+        for (std::size_t k = 0; k < m; ++k) {
+            store_tweak (x, tw[k]);
+            mul_alpha (x);
+            for (int j = 0; j < AES::BLOCKSIZE; ++j)
+                buf[k][j] = src[k * AES::BLOCKSIZE + j] ^ tw[k][j];
+        }
+        if (decrypting)
+            aes1.decrypt_blocks (buf, buf, m);
+        else
+            aes1.encrypt_blocks (buf, buf, m);
+        for (std::size_t k = 0; k < m; ++k)
+            for (int j = 0; j < AES::BLOCKSIZE; ++j)
+                dst[k * AES::BLOCKSIZE + j] = buf[k][j] ^ tw[k][j];
+        src += m * AES::BLOCKSIZE;
+        dst += m * AES::BLOCKSIZE;
+        nblock -= m;
+    }
+    store_tweak (x, t);
+}
+
+// a data unit under the encrypted tweak t. with a partial last block
+// of r octets, the last whole block swaps places with it: encryption
+// under T(m-1) gives CC, whose first r octets are the partial block,
+// and the partial plain text with the rest of CC is encrypted under
+// T(m). decryption undoes them in the reverse order of the tweaks.
+void
+AES_XTS::crypt_unit (bool const decrypting, AES::BLOCK t,
+    std::uint8_t const* src, std::size_t const size, std::uint8_t* dst)
+{
+    std::size_t const r = size % AES::BLOCKSIZE;
+    std::size_t const nblock = size / AES::BLOCKSIZE - (r > 0 ? 1 : 0);
+    crypt_blocks (decrypting, t, src, dst, nblock);
+    if (0 == r)
+        return;
+    src += nblock * AES::BLOCKSIZE;
+    dst += nblock * AES::BLOCKSIZE;
+    AES::BLOCK t1 (t);
+    mul_alpha (t1);
+    AES::BLOCK const& first = decrypting ? t1 : t;
+    AES::BLOCK const& second = decrypting ? t : t1;
+    AES::BLOCK cc;
+    for (int j = 0; j < AES::BLOCKSIZE; ++j)
+        cc[j] = src[j] ^ first[j];
+    if (decrypting)
+        aes1.decrypt (cc, cc);
+    else
+        aes1.encrypt (cc, cc);
+    for (int j = 0; j < AES::BLOCKSIZE; ++j)
+        cc[j] ^= first[j];
+    AES::BLOCK pp;
+    for (std::size_t j = 0; j < r; ++j) {
+        pp[j] = src[AES::BLOCKSIZE + j];
+        dst[AES::BLOCKSIZE + j] = cc[j];
+    }
+    for (std::size_t j = r; j < AES::BLOCKSIZE; ++j)
+        pp[j] = cc[j];
+    for (int j = 0; j < AES::BLOCKSIZE; ++j)
+        pp[j] ^= second[j];
+    if (decrypting)
+        aes1.decrypt (pp, pp);
+    else
+        aes1.encrypt (pp, pp);
+    for (int j = 0; j < AES::BLOCKSIZE; ++j)
+        dst[j] = pp[j] ^ second[j];
+}
+
+}//namespace cipher
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
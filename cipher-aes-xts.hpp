@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "cipher-aes.hpp"
+
+namespace cipher {
+
+// XTS-AES of IEEE 1619 and NIST SP 800-38E for storage encryption.
+// a data unit, such as a disk sector, is at least 16 octets and its
+// last partial block takes the ciphertext stealing. the tweak of a
+// sector is its number in 128-bit little-endian.
+class AES_XTS {
+public:
+    explicit AES_XTS (void);
+    // Key1 || Key2 for XTS-AES-128 and XTS-AES-256.
+    // the same Key1 and Key2 throw std::runtime_error.
+    AES_XTS& set_key256 (std::array<std::uint8_t,32> const& key256);
+    AES_XTS& set_key512 (std::array<std::uint8_t,64> const& key512);
+
+    // one data unit of size octets under the 16 octets tweak.
+    // dst may be the same as src.
+    void encrypt (AES::BLOCK const& tweak, void const* src, std::size_t const size, void* dst);
+    void decrypt (AES::BLOCK const& tweak, void const* src, std::size_t const size, void* dst);
+
+    // nsector data units of sector_size octets one after another,
+    // numbered from sector.
+    void encrypt_sectors (std::uint64_t const sector, std::size_t const sector_size,
+        void const* src, std::size_t const nsector, void* dst);
+    void decrypt_sectors (std::uint64_t const sector, std::size_t const sector_size,
+        void const* src, std::size_t const nsector, void* dst);
+
+private:
+    AES aes1;
+    AES aes2;
+
+    void crypt_blocks (bool const decrypting, AES::BLOCK& t,
+        std::uint8_t const* src, std::uint8_t* dst, std::size_t nblock);
+    void crypt_unit (bool const decrypting, AES::BLOCK t,
+        std::uint8_t const* src, std::size_t const size, std::uint8_t* dst);
+    void crypt_sectors (bool const decrypting, std::uint64_t const sector,
+        std::size_t const sector_size, std::uint8_t const* src, std::size_t const nsector,
+        std::uint8_t* dst);
+};
+
+}//namespace cipher
@@ -1,5 +1,10 @@
 #include <cstdint>
+#include <algorithm>
 #include "cipher-aes.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
 
 namespace cipher {
 
@@ -352,6 +357,695 @@ deround (std::uint32_t& t0, std::uint32_t& t1, std::uint32_t& t2, std::uint32_t&
     t3 = Td0[byte0 (s3)] ^ rorbyte (Td0[byte1 (s2)] ^ rorbyte (Td0[byte2 (s1)] ^ rorbyte (Td0[byte3 (s0)]))) ^ ikeys[3];
 }
 
+#if defined (CPU_FEATURES_X86)
+
+// the round keys are the AES state octets in the little-endian words,
+// so that they load into the AES-NI registers as they are.
+
+// SubWord with the S-box of the AES unit, where AESKEYGENASSIST
+// substitutes the second word of its source into the first.
+__attribute__ ((target ("aes,sse2")))
+static std::uint32_t
+sub_word_aesni (std::uint32_t const a)
+{
+    __m128i const x = _mm_set_epi32 (0, 0, static_cast<int> (a), 0);
+    return static_cast<std::uint32_t> (_mm_cvtsi128_si32 (_mm_aeskeygenassist_si128 (x, 0)));
+}
+
+// InvMixColumns of the four words of a round key
+__attribute__ ((target ("aes,sse2")))
+static void
+inv_mix_columns_aesni (std::uint32_t* rk)
+{
+    __m128i* const p = reinterpret_cast<__m128i*> (rk);
+    _mm_storeu_si128 (p, _mm_aesimc_si128 (_mm_loadu_si128 (p)));
+}
+
+__attribute__ ((target ("aes,sse2")))
+static void
+encrypt_aesni (std::uint32_t const* keys, int const nrounds,
+    std::uint8_t const* src, std::uint8_t* dst)
+{
+    __m128i const* rk = reinterpret_cast<__m128i const*> (keys);
+    __m128i x = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (src));
+    x = _mm_xor_si128 (x, _mm_loadu_si128 (rk));
+    for (int i = 1; i < nrounds; ++i)
+        x = _mm_aesenc_si128 (x, _mm_loadu_si128 (rk + i));
+    x = _mm_aesenclast_si128 (x, _mm_loadu_si128 (rk + nrounds));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst), x);
+}
+
+__attribute__ ((target ("aes,sse2")))
+static void
+decrypt_aesni (std::uint32_t const* ikeys, int const nrounds,
+    std::uint8_t const* src, std::uint8_t* dst)
+{
+    __m128i const* rk = reinterpret_cast<__m128i const*> (ikeys);
+    __m128i x = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (src));
+    x = _mm_xor_si128 (x, _mm_loadu_si128 (rk));
+    for (int i = 1; i < nrounds; ++i)
+        x = _mm_aesdec_si128 (x, _mm_loadu_si128 (rk + i));
+    x = _mm_aesdeclast_si128 (x, _mm_loadu_si128 (rk + nrounds));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst), x);
+}
+
+// eight blocks go through each round key together, so that the
+// latency of an AESENC hides behind the other seven.
+__attribute__ ((target ("aes,sse2")))
+static void
+encrypt_blocks_aesni (std::uint32_t const* keys, int const nrounds,
+    std::uint8_t const* src, std::uint8_t* dst, std::size_t n)
+{
+    __m128i const* rk = reinterpret_cast<__m128i const*> (keys);
+    for (; n >= 8; n -= 8, src += 128, dst += 128) {
+        __m128i x[8];
+        __m128i k = _mm_loadu_si128 (rk);
+        for (int j = 0; j < 8; ++j)
+            x[j] = _mm_xor_si128 (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (src + j * 16)), k);
+        for (int i = 1; i < nrounds; ++i) {
+            k = _mm_loadu_si128 (rk + i);
+            for (int j = 0; j < 8; ++j)
+                x[j] = _mm_aesenc_si128 (x[j], k);
+        }
+        k = _mm_loadu_si128 (rk + nrounds);
+        for (int j = 0; j < 8; ++j)
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + j * 16), _mm_aesenclast_si128 (x[j], k));
+    }
+    for (; n > 0; --n, src += 16, dst += 16)
+        encrypt_aesni (keys, nrounds, src, dst);
+}
+
+__attribute__ ((target ("aes,sse2")))
+static void
+decrypt_blocks_aesni (std::uint32_t const* ikeys, int const nrounds,
+    std::uint8_t const* src, std::uint8_t* dst, std::size_t n)
+{
+    __m128i const* rk = reinterpret_cast<__m128i const*> (ikeys);
+    for (; n >= 8; n -= 8, src += 128, dst += 128) {
+        __m128i x[8];
+        __m128i k = _mm_loadu_si128 (rk);
+        for (int j = 0; j < 8; ++j)
+            x[j] = _mm_xor_si128 (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (src + j * 16)), k);
+        for (int i = 1; i < nrounds; ++i) {
+            k = _mm_loadu_si128 (rk + i);
+            for (int j = 0; j < 8; ++j)
+                x[j] = _mm_aesdec_si128 (x[j], k);
+        }
+        k = _mm_loadu_si128 (rk + nrounds);
+        for (int j = 0; j < 8; ++j)
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + j * 16), _mm_aesdeclast_si128 (x[j], k));
+    }
+    for (; n > 0; --n, src += 16, dst += 16)
+        decrypt_aesni (ikeys, nrounds, src, dst);
+}
+
+#endif
+
+// bitsliced rounds, which run in constant time without AES-NI.
+// four blocks go into eight 64-bit planes where q[i] holds bit i of
+// every octet, so that SubBytes is a boolean circuit and no secret
+// ever picks a memory address. the layout follows aes_ct64 of BearSSL,
+// and the S-box is the circuit of Boyar and Peralta (eprint 2009/191).
+// the rounds are templates on the plane type: a vector of 64-bit lanes
+// runs a group of four blocks in each lane.
+
+typedef std::uint64_t bs_u64x2 __attribute__ ((vector_size (16)));
+typedef std::uint64_t bs_u64x4 __attribute__ ((vector_size (32)));
+
+static inline std::uint64_t
+bs_get_lane (std::uint64_t const& x, int const)
+{
+    return x;
+}
+
+template<class W>
+static inline std::uint64_t
+bs_get_lane (W const& x, int const k)
+{
+    return x[k];
+}
+
+static inline void
+bs_set_lane (std::uint64_t& x, int const, std::uint64_t const a)
+{
+    x = a;
+}
+
+template<class W>
+static inline void
+bs_set_lane (W& x, int const k, std::uint64_t const a)
+{
+    x[k] = a;
+}
+
+// spreads the 16-bit halves of four words of a block into two planes,
+// so that q0 takes the even octets and q1 the odd ones.
+static inline void
+bs_interleave_in (std::uint64_t& q0, std::uint64_t& q1, std::uint32_t const* w)
+{
+    std::uint64_t x0 = w[0], x1 = w[1], x2 = w[2], x3 = w[3];
+    x0 |= x0 << 16;
+    x1 |= x1 << 16;
+    x2 |= x2 << 16;
+    x3 |= x3 << 16;
+    x0 &= 0x0000ffff0000ffffULL;
+    x1 &= 0x0000ffff0000ffffULL;
+    x2 &= 0x0000ffff0000ffffULL;
+    x3 &= 0x0000ffff0000ffffULL;
+    x0 |= x0 << 8;
+    x1 |= x1 << 8;
+    x2 |= x2 << 8;
+    x3 |= x3 << 8;
+    x0 &= 0x00ff00ff00ff00ffULL;
+    x1 &= 0x00ff00ff00ff00ffULL;
+    x2 &= 0x00ff00ff00ff00ffULL;
+    x3 &= 0x00ff00ff00ff00ffULL;
+    q0 = x0 | (x2 << 8);
+    q1 = x1 | (x3 << 8);
+}
+
+// inverse of bs_interleave_in
+static inline void
+bs_interleave_out (std::uint32_t* w, std::uint64_t const q0, std::uint64_t const q1)
+{
+    std::uint64_t x0 = q0 & 0x00ff00ff00ff00ffULL;
+    std::uint64_t x1 = q1 & 0x00ff00ff00ff00ffULL;
+    std::uint64_t x2 = (q0 >> 8) & 0x00ff00ff00ff00ffULL;
+    std::uint64_t x3 = (q1 >> 8) & 0x00ff00ff00ff00ffULL;
+    x0 |= x0 >> 8;
+    x1 |= x1 >> 8;
+    x2 |= x2 >> 8;
+    x3 |= x3 >> 8;
+    x0 &= 0x0000ffff0000ffffULL;
+    x1 &= 0x0000ffff0000ffffULL;
+    x2 &= 0x0000ffff0000ffffULL;
+    x3 &= 0x0000ffff0000ffffULL;
+    w[0] = static_cast<std::uint32_t> (x0 | (x0 >> 16));
+    w[1] = static_cast<std::uint32_t> (x1 | (x1 >> 16));
+    w[2] = static_cast<std::uint32_t> (x2 | (x2 >> 16));
+    w[3] = static_cast<std::uint32_t> (x3 | (x3 >> 16));
+}
+
+template<class W>
+static inline void
+bs_swap (W& x, W& y, std::uint64_t const cl, int const s)
+{
+    W const a = x;
+    W const b = y;
+    x = (a & cl) | ((b & cl) << s);
+    y = ((a >> s) & cl) | (b & ~cl);
+}
+
+// transposes the 8x8 bit matrices between octets and bit planes.
+// it is its own inverse.
+template<class W>
+static inline void
+bs_ortho (W* q)
+{
+    bs_swap (q[0], q[1], 0x5555555555555555ULL, 1);
+    bs_swap (q[2], q[3], 0x5555555555555555ULL, 1);
+    bs_swap (q[4], q[5], 0x5555555555555555ULL, 1);
+    bs_swap (q[6], q[7], 0x5555555555555555ULL, 1);
+
+    bs_swap (q[0], q[2], 0x3333333333333333ULL, 2);
+    bs_swap (q[1], q[3], 0x3333333333333333ULL, 2);
+    bs_swap (q[4], q[6], 0x3333333333333333ULL, 2);
+    bs_swap (q[5], q[7], 0x3333333333333333ULL, 2);
+
+    bs_swap (q[0], q[4], 0x0f0f0f0f0f0f0f0fULL, 4);
+    bs_swap (q[1], q[5], 0x0f0f0f0f0f0f0f0fULL, 4);
+    bs_swap (q[2], q[6], 0x0f0f0f0f0f0f0f0fULL, 4);
+    bs_swap (q[3], q[7], 0x0f0f0f0f0f0f0f0fULL, 4);
+}
+
+// groups of four blocks of 32-bit words into the lanes of the planes
+template<class W>
+static inline void
+bs_load (W* q, std::uint32_t const* w)
+{
+    for (int k = 0; k < static_cast<int> (sizeof (W) / 8); ++k) {
+        for (int i = 0; i < 4; ++i) {
+            std::uint64_t q0, q1;
+            bs_interleave_in (q0, q1, w + k * 16 + i * 4);
+            bs_set_lane (q[i], k, q0);
+            bs_set_lane (q[i + 4], k, q1);
+        }
+    }
+    bs_ortho (q);
+}
+
+template<class W>
+static inline void
+bs_store (std::uint32_t* w, W* q)
+{
+    bs_ortho (q);
+    for (int k = 0; k < static_cast<int> (sizeof (W) / 8); ++k)
+        for (int i = 0; i < 4; ++i)
+            bs_interleave_out (w + k * 16 + i * 4, bs_get_lane (q[i], k), bs_get_lane (q[i + 4], k));
+}
+
+// SubBytes with 32 AND and 83 XOR or XNOR gates.
+// x0 is the most significant bit of an octet and x7 the least.
+template<class W>
+static inline void
+bs_sub_bytes (W* q)
+{
+    W const x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+    W const x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // top linear transformation
+    W const y14 = x3 ^ x5;
+    W const y13 = x0 ^ x6;
+    W const y9 = x0 ^ x3;
+    W const y8 = x0 ^ x5;
+    W const t0 = x1 ^ x2;
+    W const y1 = t0 ^ x7;
+    W const y4 = y1 ^ x3;
+    W const y12 = y13 ^ y14;
+    W const y2 = y1 ^ x0;
+    W const y5 = y1 ^ x6;
+    W const y3 = y5 ^ y8;
+    W const t1 = x4 ^ y12;
+    W const y15 = t1 ^ x5;
+    W const y20 = t1 ^ x1;
+    W const y6 = y15 ^ x7;
+    W const y10 = y15 ^ t0;
+    W const y11 = y20 ^ y9;
+    W const y7 = x7 ^ y11;
+    W const y17 = y10 ^ y11;
+    W const y19 = y10 ^ y8;
+    W const y16 = t0 ^ y11;
+    W const y21 = y13 ^ y16;
+    W const y18 = x0 ^ y16;
+
+    // inversion in GF(2^4)^2
+    W const t2 = y12 & y15;
+    W const t3 = y3 & y6;
+    W const t4 = t3 ^ t2;
+    W const t5 = y4 & x7;
+    W const t6 = t5 ^ t2;
+    W const t7 = y13 & y16;
+    W const t8 = y5 & y1;
+    W const t9 = t8 ^ t7;
+    W const t10 = y2 & y7;
+    W const t11 = t10 ^ t7;
+    W const t12 = y9 & y11;
+    W const t13 = y14 & y17;
+    W const t14 = t13 ^ t12;
+    W const t15 = y8 & y10;
+    W const t16 = t15 ^ t12;
+    W const t17 = t4 ^ t14;
+    W const t18 = t6 ^ t16;
+    W const t19 = t9 ^ t14;
+    W const t20 = t11 ^ t16;
+    W const t21 = t17 ^ y20;
+    W const t22 = t18 ^ y19;
+    W const t23 = t19 ^ y21;
+    W const t24 = t20 ^ y18;
+
+    W const t25 = t21 ^ t22;
+    W const t26 = t21 & t23;
+    W const t27 = t24 ^ t26;
+    W const t28 = t25 & t27;
+    W const t29 = t28 ^ t22;
+    W const t30 = t23 ^ t24;
+    W const t31 = t22 ^ t26;
+    W const t32 = t31 & t30;
+    W const t33 = t32 ^ t24;
+    W const t34 = t23 ^ t33;
+    W const t35 = t27 ^ t33;
+    W const t36 = t24 & t35;
+    W const t37 = t36 ^ t34;
+    W const t38 = t27 ^ t36;
+    W const t39 = t29 & t38;
+    W const t40 = t25 ^ t39;
+
+    W const t41 = t40 ^ t37;
+    W const t42 = t29 ^ t33;
+    W const t43 = t29 ^ t40;
+    W const t44 = t33 ^ t37;
+    W const t45 = t42 ^ t41;
+    W const z0 = t44 & y15;
+    W const z1 = t37 & y6;
+    W const z2 = t33 & x7;
+    W const z3 = t43 & y16;
+    W const z4 = t40 & y1;
+    W const z5 = t29 & y7;
+    W const z6 = t42 & y11;
+    W const z7 = t45 & y17;
+    W const z8 = t41 & y10;
+    W const z9 = t44 & y12;
+    W const z10 = t37 & y3;
+    W const z11 = t33 & y4;
+    W const z12 = t43 & y13;
+    W const z13 = t40 & y5;
+    W const z14 = t29 & y2;
+    W const z15 = t42 & y9;
+    W const z16 = t45 & y14;
+    W const z17 = t41 & y8;
+
+    // bottom linear transformation
+    W const t46 = z15 ^ z16;
+    W const t47 = z10 ^ z11;
+    W const t48 = z5 ^ z13;
+    W const t49 = z9 ^ z10;
+    W const t50 = z2 ^ z12;
+    W const t51 = z2 ^ z5;
+    W const t52 = z7 ^ z8;
+    W const t53 = z0 ^ z3;
+    W const t54 = z6 ^ z7;
+    W const t55 = z16 ^ z17;
+    W const t56 = z12 ^ t48;
+    W const t57 = t50 ^ t53;
+    W const t58 = z4 ^ t46;
+    W const t59 = z3 ^ t54;
+    W const t60 = t46 ^ t57;
+    W const t61 = z14 ^ t57;
+    W const t62 = t52 ^ t58;
+    W const t63 = t49 ^ t58;
+    W const t64 = z4 ^ t59;
+    W const t65 = t61 ^ t62;
+    W const t66 = z1 ^ t63;
+    W const s0 = t59 ^ t63;
+    W const s6 = t56 ^ ~t62;
+    W const s7 = t48 ^ ~t60;
+    W const t67 = t64 ^ t65;
+    W const s3 = t53 ^ t66;
+    W const s4 = t51 ^ t66;
+    W const s5 = t47 ^ t65;
+    W const s1 = t64 ^ ~s3;
+    W const s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+// the affine map of the S-box is undone on both sides of the same
+// circuit, which leaves the inversion in GF(2^8).
+template<class W>
+static inline void
+bs_inv_affine (W* q)
+{
+    W const q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3];
+    W const q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+template<class W>
+static inline void
+bs_inv_sub_bytes (W* q)
+{
+    bs_inv_affine (q);
+    bs_sub_bytes (q);
+    bs_inv_affine (q);
+}
+
+// each 16-bit group of a plane is a row of the four blocks
+template<class W>
+static inline void
+bs_shift_rows (W* q)
+{
+    for (int i = 0; i < 8; ++i) {
+        W const x = q[i];
+        q[i] = (x & 0x000000000000ffffULL)
+            | ((x & 0x00000000fff00000ULL) >> 4)
+            | ((x & 0x00000000000f0000ULL) << 12)
+            | ((x & 0x0000ff0000000000ULL) >> 8)
+            | ((x & 0x000000ff00000000ULL) << 8)
+            | ((x & 0xf000000000000000ULL) >> 12)
+            | ((x & 0x0fff000000000000ULL) << 4);
+    }
+}
+
+template<class W>
+static inline void
+bs_inv_shift_rows (W* q)
+{
+    for (int i = 0; i < 8; ++i) {
+        W const x = q[i];
+        q[i] = (x & 0x000000000000ffffULL)
+            | ((x & 0x000000000fff0000ULL) << 4)
+            | ((x & 0x00000000f0000000ULL) >> 12)
+            | ((x & 0x000000ff00000000ULL) << 8)
+            | ((x & 0x0000ff0000000000ULL) >> 8)
+            | ((x & 0x000f000000000000ULL) << 12)
+            | ((x & 0xfff0000000000000ULL) >> 4);
+    }
+}
+
+// the next row of each column in r, and x ^ r two rows further in q.
+template<class W>
+static inline void
+bs_mix_columns (W* q)
+{
+    W r[8], t[8];
+    for (int i = 0; i < 8; ++i) {
+        r[i] = (q[i] >> 16) | (q[i] << 48);
+        t[i] = q[i] ^ r[i];
+        t[i] = (t[i] << 32) | (t[i] >> 32);
+    }
+    W const q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    W const q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    q[0] = q7 ^ r[7] ^ r[0] ^ t[0];
+    q[1] = q0 ^ r[0] ^ q7 ^ r[7] ^ r[1] ^ t[1];
+    q[2] = q1 ^ r[1] ^ r[2] ^ t[2];
+    q[3] = q2 ^ r[2] ^ q7 ^ r[7] ^ r[3] ^ t[3];
+    q[4] = q3 ^ r[3] ^ q7 ^ r[7] ^ r[4] ^ t[4];
+    q[5] = q4 ^ r[4] ^ r[5] ^ t[5];
+    q[6] = q5 ^ r[5] ^ r[6] ^ t[6];
+    q[7] = q6 ^ r[6] ^ r[7] ^ t[7];
+}
+
+// InvMixColumns is MixColumns after multiplying each column
+// by 04x^2 + 05, that is, a ^= 4 * (a ^ (a two rows further)).
+template<class W>
+static inline void
+bs_inv_mix_columns (W* q)
+{
+    W u[8];
+    for (int i = 0; i < 8; ++i)
+        u[i] = q[i] ^ ((q[i] << 32) | (q[i] >> 32));
+    // 4 * u in GF(2^8) with the polynomial 0x11b
+    q[0] ^= u[6];
+    q[1] ^= u[6] ^ u[7];
+    q[2] ^= u[0] ^ u[7];
+    q[3] ^= u[1] ^ u[6];
+    q[4] ^= u[2] ^ u[6] ^ u[7];
+    q[5] ^= u[3] ^ u[7];
+    q[6] ^= u[4];
+    q[7] ^= u[5];
+    bs_mix_columns (q);
+}
+
+// the planes of a round key are the same in every lane
+template<class W>
+static inline void
+bs_add_round_key (W* q, std::uint64_t const* sk)
+{
+    for (int i = 0; i < 8; ++i)
+        q[i] ^= sk[i];
+}
+
+template<class W>
+static inline void
+bs_encrypt (std::uint64_t const* sk, int const nrounds, W* q)
+{
+    bs_add_round_key (q, sk);
+    for (int r = 1; r < nrounds; ++r) {
+        bs_sub_bytes (q);
+        bs_shift_rows (q);
+        bs_mix_columns (q);
+        bs_add_round_key (q, sk + r * 8);
+    }
+    bs_sub_bytes (q);
+    bs_shift_rows (q);
+    bs_add_round_key (q, sk + nrounds * 8);
+}
+
+// the equivalent inverse cipher, as AESDEC runs it
+template<class W>
+static inline void
+bs_decrypt (std::uint64_t const* sk, int const nrounds, W* q)
+{
+    bs_add_round_key (q, sk);
+    for (int r = 1; r < nrounds; ++r) {
+        bs_inv_sub_bytes (q);
+        bs_inv_shift_rows (q);
+        bs_inv_mix_columns (q);
+        bs_add_round_key (q, sk + r * 8);
+    }
+    bs_inv_sub_bytes (q);
+    bs_inv_shift_rows (q);
+    bs_add_round_key (q, sk + nrounds * 8);
+}
+
+// every round key in all four block positions of the planes
+static void
+bs_expand_keys (std::uint32_t const* rk, int const nrounds, std::uint64_t* sk)
+{
+    for (int r = 0; r <= nrounds; ++r, rk += 4, sk += 8) {
+        std::uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = rk[i & 3];
+        bs_load (sk, w);
+    }
+}
+
+// n blocks in groups of 4 * sizeof (W) / 8, where the last group
+// repeats the first block in its unused places.
+template<class W, bool DECRYPT>
+static inline void
+bs_crypt_planes (std::uint64_t const* sk, int const nrounds,
+    BLOCK const* src, BLOCK* dst, std::size_t n)
+{
+    enum { NBLOCK = 4 * sizeof (W) / 8 };
+    std::uint32_t w[NBLOCK * 4];
+    W q[8];
+    while (n > 0) {
+        std::size_t const m = n < NBLOCK ? n : NBLOCK;
+        for (std::size_t k = 0; k < NBLOCK; ++k) {
+            BLOCK const& b = src[k < m ? k : 0];
+            for (int i = 0; i < 4; ++i)
+                w[k * 4 + i] = unpack32 (b[i * 4], b[i * 4 + 1], b[i * 4 + 2], b[i * 4 + 3]);
+        }
+        bs_load (q, w);
+        if (DECRYPT)
+            bs_decrypt (sk, nrounds, q);
+        else
+            bs_encrypt (sk, nrounds, q);
+        bs_store (w, q);
+        for (std::size_t k = 0; k < m; ++k) {
+            BLOCK& b = dst[k];
+            for (int i = 0; i < 4; ++i)
+                pack32 (b[i * 4], b[i * 4 + 1], b[i * 4 + 2], b[i * 4 + 3], w[k * 4 + i]);
+        }
+        src += m;
+        dst += m;
+        n -= m;
+    }
+}
+
+#if defined (CPU_FEATURES_X86)
+
+// sixteen blocks in the 256-bit planes. flatten inlines the templates
+// here, so that they are compiled for AVX2.
+template<bool DECRYPT>
+__attribute__ ((target ("avx2"), flatten))
+static void
+bs_crypt_blocks_avx2 (std::uint64_t const* sk, int const nrounds,
+    BLOCK const* src, BLOCK* dst, std::size_t n)
+{
+    bs_crypt_planes<bs_u64x4, DECRYPT> (sk, nrounds, src, dst, n);
+}
+
+#endif
+
+// whole groups of sixteen blocks on AVX2, the others in the
+// 128-bit planes of eight blocks, or the 64-bit ones of four
+// when no more are left, as for a single block.
+template<bool DECRYPT>
+static void
+bs_crypt_blocks (std::uint64_t const* sk, int const nrounds,
+    BLOCK const* src, BLOCK* dst, std::size_t n)
+{
+#if defined (CPU_FEATURES_X86)
+    static bool const avx2 = cpu::has_avx2 ();
+    std::size_t const nwide = n & ~static_cast<std::size_t> (15);
+    if (avx2 && nwide > 0) {
+        bs_crypt_blocks_avx2<DECRYPT> (sk, nrounds, src, dst, nwide);
+        src += nwide;
+        dst += nwide;
+        n -= nwide;
+    }
+#endif
+    if (n > 4)
+        bs_crypt_planes<bs_u64x2, DECRYPT> (sk, nrounds, src, dst, n);
+    else if (n > 0)
+        bs_crypt_planes<std::uint64_t, DECRYPT> (sk, nrounds, src, dst, n);
+}
+
+// SubWord of the key schedule through the circuit
+static std::uint32_t
+sub_word_bitslice (std::uint32_t const a)
+{
+    std::uint64_t q[8] = {a, 0, 0, 0, 0, 0, 0, 0};
+    bs_ortho (q);
+    bs_sub_bytes (q);
+    bs_ortho (q);
+    return static_cast<std::uint32_t> (q[0]);
+}
+
+// doubles each octet of a word in GF(2^8) without a branch
+static inline std::uint32_t
+xtime32 (std::uint32_t const a)
+{
+    return ((a & 0x7f7f7f7fUL) << 1) ^ (((a >> 7) & 0x01010101UL) * 0x1bU);
+}
+
+// InvMixColumns of a round key word without the tables
+static inline std::uint32_t
+inv_mix_column_bitslice (std::uint32_t const a)
+{
+    std::uint32_t const u = a ^ xtime32 (xtime32 (a ^ rolbyte (rolbyte (a))));
+    std::uint32_t const r1 = rolbyte (u);
+    return xtime32 (u ^ r1) ^ r1 ^ rolbyte (r1) ^ rolbyte (rolbyte (r1));
+}
+
+static AES::engine_type
+detect_engine ()
+{
+    if (cpu::has_aes ())
+        return AES::ENGINE_AESNI;
+    return AES::ENGINE_BITSLICE;
+}
+
+static AES::engine_type aes_engine = detect_engine ();
+
+bool
+AES::select_engine (engine_type const e)
+{
+    engine_type const available = detect_engine ();
+    if (ENGINE_AUTO == e)
+        aes_engine = available;
+    else if (ENGINE_AESNI == e && ENGINE_AESNI != available)
+        return false;
+    else
+        aes_engine = e;
+    return true;
+}
+
+AES::engine_type
+AES::engine ()
+{
+    return aes_engine;
+}
+
+// substitute each byte of a key schedule word
+static inline std::uint32_t
+sub_word (std::uint32_t const a)
+{
+#if defined (CPU_FEATURES_X86)
+    if (AES::ENGINE_AESNI == aes_engine)
+        return sub_word_aesni (a);
+#endif
+    if (AES::ENGINE_BITSLICE == aes_engine)
+        return sub_word_bitslice (a);
+    return subbyte (SBOX, a);
+}
+
 // schedule encrypt round key from 128 bit key
 void
 AES::set_encrypt_key128 (std::array<std::uint8_t,16> const& key)
@@ -420,11 +1114,11 @@ AES::schedule_encrypt_keys (int const nk, int const nr, std::uint32_t* rk)
     std::uint32_t rcon = 1U;
     for (int i = nk, j = 0; i < lastkey; ++i) {
         if (j == 0) {
-            rk[i] = rk[i - nk] ^ subbyte (SBOX, rolbyte (rk[i - 1])) ^ rcon;
+            rk[i] = rk[i - nk] ^ sub_word (rolbyte (rk[i - 1])) ^ rcon;
             rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x11b : 0);
         }
         else if (nk > 6 && j == 4) {
-            rk[i] = rk[i - nk] ^ subbyte (SBOX, rk[i - 1]);
+            rk[i] = rk[i - nk] ^ sub_word (rk[i - 1]);
         }
         else {
             rk[i] = rk[i - nk] ^ rk[i - 1];
@@ -432,6 +1126,9 @@ AES::schedule_encrypt_keys (int const nk, int const nr, std::uint32_t* rk)
         j = j + 1 == nk ? 0 : j + 1;
     }
     nrounds = nr;
+    // schedule_decrypt_keys comes here with ikeys and expands them itself
+    if (ENGINE_AESNI != aes_engine && keys == rk)
+        bs_expand_keys (keys, nrounds, bskeys);
 }
 
 // schedule decrypt round key for various bit size key
@@ -447,17 +1144,42 @@ AES::schedule_decrypt_keys (int const nk, int const nr, std::uint32_t* rk)
     }
     for (int i = 1; i < nrounds; ++i) {
         rk += 4;
+#if defined (CPU_FEATURES_X86)
+        if (ENGINE_AESNI == aes_engine) {
+            inv_mix_columns_aesni (rk);
+            continue;
+        }
+#endif
+        if (ENGINE_BITSLICE == aes_engine) {
+            rk[0] = inv_mix_column_bitslice (rk[0]);
+            rk[1] = inv_mix_column_bitslice (rk[1]);
+            rk[2] = inv_mix_column_bitslice (rk[2]);
+            rk[3] = inv_mix_column_bitslice (rk[3]);
+            continue;
+        }
         rk[0] = inv_mix_column (rk[0]);
         rk[1] = inv_mix_column (rk[1]);
         rk[2] = inv_mix_column (rk[2]);
         rk[3] = inv_mix_column (rk[3]);
     }
+    if (ENGINE_AESNI != aes_engine)
+        bs_expand_keys (ikeys, nrounds, bsikeys);
 }
 
 // encrypt one block
 void
 AES::encrypt (BLOCK const& plain, BLOCK& secret)
 {
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_AESNI == aes_engine) {
+        encrypt_aesni (keys, nrounds, plain.data (), secret.data ());
+        return;
+    }
+#endif
+    if (ENGINE_BITSLICE == aes_engine) {
+        encrypt_blocks (&plain, &secret, 1);
+        return;
+    }
     std::uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
 
     s0 = unpack32 (plain[ 0], plain[ 1], plain[ 2], plain[ 3]) ^ keys[0];
@@ -498,6 +1220,16 @@ AES::encrypt (BLOCK const& plain, BLOCK& secret)
 void
 AES::decrypt (BLOCK const& secret, BLOCK& plain)
 {
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_AESNI == aes_engine) {
+        decrypt_aesni (ikeys, nrounds, secret.data (), plain.data ());
+        return;
+    }
+#endif
+    if (ENGINE_BITSLICE == aes_engine) {
+        decrypt_blocks (&secret, &plain, 1);
+        return;
+    }
     std::uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
 
     s0 = unpack32 (secret[ 0], secret[ 1], secret[ 2], secret[ 3]) ^ ikeys[0];
@@ -534,6 +1266,110 @@ AES::decrypt (BLOCK const& secret, BLOCK& plain)
     pack32 (plain[12], plain[13], plain[14], plain[15], s3);
 }
 
+// the table rounds of the blocks have no dependency on each other,
+// so the out-of-order core overlaps them in this loop.
+void
+AES::encrypt_blocks (BLOCK const* plain, BLOCK* secret, std::size_t n)
+{
+    if (0 == n)
+        return;
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_AESNI == aes_engine) {
+        encrypt_blocks_aesni (keys, nrounds, plain[0].data (), secret[0].data (), n);
+        return;
+    }
+#endif
+    if (ENGINE_BITSLICE == aes_engine) {
+        bs_crypt_blocks<false> (bskeys, nrounds, plain, secret, n);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        encrypt (plain[i], secret[i]);
+}
+
+void
+AES::decrypt_blocks (BLOCK const* secret, BLOCK* plain, std::size_t n)
+{
+    if (0 == n)
+        return;
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_AESNI == aes_engine) {
+        decrypt_blocks_aesni (ikeys, nrounds, secret[0].data (), plain[0].data (), n);
+        return;
+    }
+#endif
+    if (ENGINE_BITSLICE == aes_engine) {
+        bs_crypt_blocks<true> (bsikeys, nrounds, secret, plain, n);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        decrypt (secret[i], plain[i]);
+}
+
+// ctr += n in big-endian over the octets from d to the last.
+static inline void
+add_counter (int const d, BLOCK& ctr, std::uint64_t n)
+{
+    unsigned int carry = 0;
+    for (int i = AES::BLOCKSIZE - 1; i >= d; --i) {
+        unsigned int const x = ctr[i] + (n & 0xffU) + carry;
+        ctr[i] = static_cast<std::uint8_t> (x);
+        carry = x >> 8;
+        n >>= 8;
+    }
+}
+
+static inline int
+counter_offset (AES::counter_inc const inc)
+{
+    return AES::COUNTER_INC64 == inc ? AES::BLOCKSIZE - 8 : 0;
+}
+
+void
+AES::step_counter (counter_inc const inc, BLOCK& ctr)
+{
+    add_counter (counter_offset (inc), ctr, 1);
+}
+
+// the counters go to encrypt_blocks NBULK blocks at a time. unless the
+// last octet wraps around in a batch, its counters are copies of ctr
+// that differ only in that octet, which goes much faster than carrying
+// through each one. the counters are not secret, so the branch is not
+// a leak.
+void
+AES::xor_counter_blocks (counter_inc const inc, BLOCK& ctr,
+    std::uint8_t const* src, std::uint8_t* dst, std::size_t nblock)
+{
+    enum { NBULK = 16 };
+    int const d = counter_offset (inc);
+    BLOCK c[NBULK];
+    BLOCK ks[NBULK];
+    while (nblock > 0) {
+        std::size_t const m = std::min<std::size_t> (NBULK, nblock);
+        unsigned int const low = ctr[BLOCKSIZE - 1];
+        if (low + m <= 256) {
+            for (std::size_t k = 0; k < m; ++k) {
+                c[k] = ctr;
+                c[k][BLOCKSIZE - 1] = static_cast<std::uint8_t> (low + k);
+            }
+            add_counter (d, ctr, m);
+        }
+        else {
+            for (std::size_t k = 0; k < m; ++k) {
+                c[k] = ctr;
+                add_counter (d, ctr, 1);
+            }
+        }
+        encrypt_blocks (c, ks, m);
+        for (std::size_t k = 0; k < m; ++k)
+            for (int j = 0; j < BLOCKSIZE; ++j)
+                dst[k * BLOCKSIZE + j] = src[k * BLOCKSIZE + j] ^ ks[k][j];
+        src += m * BLOCKSIZE;
+        dst += m * BLOCKSIZE;
+        nblock -= m;
+    }
+}
+
 //  // generate SBOX, Te0, IBOX, Td0
 //  struct rijndael_table_generator {
 //      std::array<int,256> lntable;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <array>
 
 namespace cipher {
@@ -9,6 +10,17 @@ class AES {
 public:
     enum { BLOCKSIZE = 16 };
     using BLOCK = std::array<std::uint8_t,16>;
+
+    // round functions and key schedules.
+    // ENGINE_AUTO picks AES-NI when the cpu has it, and the bitsliced
+    // circuits otherwise, both in constant time. ENGINE_PORTABLE takes
+    // the lookup tables. all keep the round keys alike, so a key works
+    // with any engine, except that a key set under ENGINE_AESNI has no
+    // bitsliced round keys and must be set again for ENGINE_BITSLICE.
+    enum engine_type { ENGINE_AUTO, ENGINE_PORTABLE, ENGINE_AESNI, ENGINE_BITSLICE };
+    static bool select_engine (engine_type const e);
+    static engine_type engine ();
+
     AES () {}
     void set_encrypt_key128 (std::array<std::uint8_t,16> const& key);
     void set_encrypt_key192 (std::array<std::uint8_t,24> const& key);
@@ -18,11 +30,30 @@ public:
     void set_decrypt_key256 (std::array<std::uint8_t,32> const& key);
     void encrypt (BLOCK const& plain, BLOCK& secret);
     void decrypt (BLOCK const& secret, BLOCK& plain);
+    // n independent blocks, interleaved so that their rounds overlap.
+    // out may be the same as in.
+    void encrypt_blocks (BLOCK const* plain, BLOCK* secret, std::size_t n);
+    void decrypt_blocks (BLOCK const* secret, BLOCK* plain, std::size_t n);
+
+    // counter mode of AES_CTR, AES_GCM and AES_SIV.
+    // step_counter adds one in constant time to the whole counter in
+    // 128-bit big-endian, or to its low 64 bits for COUNTER_INC64.
+    // xor_counter_blocks xors nblock blocks with the key stream of the
+    // counters from ctr, and leaves ctr at the one after them.
+    // dst may be the same as src.
+    enum counter_inc { COUNTER_INC128, COUNTER_INC64 };
+    static void step_counter (counter_inc const inc, BLOCK& ctr);
+    void xor_counter_blocks (counter_inc const inc, BLOCK& ctr,
+        std::uint8_t const* src, std::uint8_t* dst, std::size_t nblock);
 
 private:
     int nrounds;
     std::uint32_t keys[60];
     std::uint32_t ikeys[60];
+    // round keys in the bit planes of four blocks, made with the key
+    // schedule, so that encryption only reads the object.
+    std::uint64_t bskeys[120];
+    std::uint64_t bsikeys[120];
 
     void schedule_encrypt_keys (int const nk, int const nr, std::uint32_t *rk);
     void schedule_decrypt_keys (int const nk, int const nr, std::uint32_t *rk);
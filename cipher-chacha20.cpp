@@ -162,18 +162,19 @@ CHACHA20::decrypt (void)
     return *this;
 }
 
-std::string
-CHACHA20::update (std::string::const_iterator s, std::string::const_iterator e)
+void
+CHACHA20::update (void const* src, std::size_t size, void* dst)
 {
     if (ENCRYPT != state && DECRYPT != state)
         throw std::runtime_error ("update() decends encrypt() or decrypt().");
-    if (s >= e)
-        return "";
+    if (0 == size)
+        return;
     if (DECRYPT == state)
-        poly1305.add (s, e);
-    std::string dst;
-    while (s < e) {
-        dst.push_back (static_cast<std::uint8_t> (*s++) ^ key_stream[pos]);
+        poly1305.add (src, size);
+    std::uint8_t const* s = static_cast<std::uint8_t const*> (src);
+    std::uint8_t* d = static_cast<std::uint8_t*> (dst);
+    for (std::size_t i = 0; i < size; ++i) {
+        d[i] = s[i] ^ key_stream[pos];
         if (++pos >= key_stream.size ()) {
             if (++counter == iv)
                 throw std::runtime_error ("chacha20 counter overflow");
@@ -182,14 +183,27 @@ CHACHA20::update (std::string::const_iterator s, std::string::const_iterator e)
         }
     }
     if (ENCRYPT == state)
-        poly1305.add (dst);
-    return std::move (dst);    
+        poly1305.add (dst, size);
+}
+
+std::string
+CHACHA20::update (octets::view const& data)
+{
+    std::string dst (data.size (), 0);
+    update (data.data (), data.size (), &dst[0]);
+    return std::move (dst);
+}
+
+std::string
+CHACHA20::update (std::string::const_iterator s, std::string::const_iterator e)
+{
+    return update (octets::view (s, e));
 }
 
 std::string
 CHACHA20::update (std::string const& data)
 {
-    return update (data.cbegin (), data.cend ());
+    return update (octets::view (data));
 }
 
 std::string
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 #include <array>
+#include "octets-view.hpp"
 #include "digest-poly1305.hpp"
 
 namespace cipher {
@@ -26,6 +27,9 @@ public:
 
     std::string update (std::string::const_iterator s, std::string::const_iterator e);
     std::string update (std::string const& data);
+    std::string update (octets::view const& data);
+    // writes size octets to dst, which may be the same as src.
+    void update (void const* src, std::size_t size, void* dst);
 
 private:
     enum { INIT, DECRYPT, ENCRYPT, FINAL };
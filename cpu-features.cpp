@@ -0,0 +1,129 @@
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <cpuid.h>
+#endif
+
+namespace cpu {
+
+// CPUID leaf 1 edx and ecx, and leaf 7 ebx bits
+enum {
+    EDX1_SSE2    = 1U << 26,
+    ECX1_PCLMUL  = 1U << 1,
+    ECX1_SSSE3   = 1U << 9,
+    ECX1_SSE41   = 1U << 19,
+    ECX1_AES     = 1U << 25,
+    ECX1_OSXSAVE = 1U << 27,
+    ECX1_AVX     = 1U << 28,
+    EBX7_AVX2    = 1U << 5,
+    EBX7_SHA     = 1U << 29,
+};
+
+// XCR0 bits the OS sets when it saves the SSE and AVX registers
+enum { XCR0_SSE = 1U << 1, XCR0_AVX = 1U << 2 };
+
+struct features {
+    unsigned int edx1;
+    unsigned int ecx1;
+    unsigned int ebx7;
+    bool ymm_enabled;
+
+    features () : edx1 (0), ecx1 (0), ebx7 (0), ymm_enabled (false)
+    {
+#if defined (CPU_FEATURES_X86)
+        unsigned int eax, ebx, ecx, edx;
+        unsigned int const maxleaf = __get_cpuid_max (0, 0);
+        if (maxleaf >= 1 && __get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+            edx1 = edx;
+            ecx1 = ecx;
+        }
+        if (maxleaf >= 7) {
+            __cpuid_count (7, 0, eax, ebx, ecx, edx);
+            ebx7 = ebx;
+        }
+        if ((ecx1 & ECX1_OSXSAVE) != 0 && (ecx1 & ECX1_AVX) != 0) {
+            unsigned int xcr0_lo, xcr0_hi;
+            __asm__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+            ymm_enabled = (xcr0_lo & (XCR0_SSE | XCR0_AVX)) == (XCR0_SSE | XCR0_AVX);
+        }
+#endif
+    }
+};
+
+static features const&
+detected ()
+{
+    static features const f;
+    return f;
+}
+
+bool
+has_sse2 ()
+{
+    return (detected ().edx1 & EDX1_SSE2) != 0;
+}
+
+bool
+has_ssse3 ()
+{
+    return (detected ().ecx1 & ECX1_SSSE3) != 0;
+}
+
+bool
+has_sse41 ()
+{
+    return (detected ().ecx1 & ECX1_SSE41) != 0;
+}
+
+bool
+has_aes ()
+{
+    return (detected ().ecx1 & ECX1_AES) != 0;
+}
+
+bool
+has_pclmul ()
+{
+    return (detected ().ecx1 & ECX1_PCLMUL) != 0;
+}
+
+bool
+has_sha ()
+{
+    return (detected ().ebx7 & EBX7_SHA) != 0;
+}
+
+bool
+has_avx2 ()
+{
+    return detected ().ymm_enabled && (detected ().ebx7 & EBX7_AVX2) != 0;
+}
+
+}//namespace cpu
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,20 @@
+#pragma once
+
+// runtime detection of the instruction set extensions
+// that the digest and cipher engines make use of.
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define CPU_FEATURES_X86 1
+#endif
+
+namespace cpu {
+
+bool has_sse2 ();
+bool has_ssse3 ();
+bool has_sse41 ();
+bool has_aes ();
+bool has_pclmul ();
+bool has_sha ();
+bool has_avx2 ();
+
+}//namespace cpu
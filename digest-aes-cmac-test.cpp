@@ -111,7 +111,7 @@ decode_hex (std::string const& hex)
 int
 main (int argc, char* argv[])
 {
-    test::simple ts (NBLOCK);
+    test::simple ts (NBLOCK * 3);
     for (int i = 0; i < NBLOCK; ++i) {
         std::string const keystr = decode_hex (spec[i].key);
         std::string const plain = decode_hex (spec[i].plain);
@@ -138,6 +138,20 @@ main (int argc, char* argv[])
 
         aes_cmac.add (plain);
         ts.ok (aes_cmac.digest () == tag, "");
+
+        // the final full block must survive adding in pieces.
+        aes_cmac.reset ();
+        for (std::size_t j = 0; j < plain.size (); j += 8)
+            aes_cmac.add (plain.substr (j, 8));
+        ts.ok (aes_cmac.digest () == tag, "add by 8 octets");
+
+        // resume from the exported state with the same key.
+        std::size_t const half = plain.size () / 2;
+        aes_cmac.reset ().add (plain.substr (0, half));
+        std::string const state = aes_cmac.export_state ();
+        aes_cmac.reset ();
+        ts.ok (aes_cmac.import_state (state)
+            && aes_cmac.add (plain.substr (half)).digest () == tag, "import_state");
     }
     return ts.done_testing ();
 }
@@ -39,11 +39,11 @@ AES_CMAC::set_key256 (std::array<std::uint8_t,32> const& key)
     return *this;
 }
 
-std::string
-AES_CMAC::digest ()
+void
+AES_CMAC::digest_into (std::uint8_t* out)
 {
     finish ();
-    return std::string (sum.begin (), sum.end ());
+    std::copy (sum.begin (), sum.end (), out);
 }
 
 void
@@ -53,14 +53,31 @@ AES_CMAC::init_sum ()
 }
 
 void
-AES_CMAC::update_sum (std::string::const_iterator s)
+AES_CMAC::update_blocks (std::uint8_t const* p, std::size_t nblocks)
 {
     BLOCK w;
-    for (int i = 0; i < 16; ++i) {
-        std::uint8_t const x = static_cast<std::uint8_t> (*s++);
-        w[i] = sum[i] ^ x;
+    BLOCK x = sum;
+    for (; nblocks > 0; --nblocks, p += 16) {
+        for (int i = 0; i < 16; ++i)
+            w[i] = x[i] ^ p[i];
+        cipher.encrypt (w, x);
     }
-    cipher.encrypt (w, sum);
+    sum = x;
+}
+
+void
+AES_CMAC::export_sum (std::string& out) const
+{
+    out.append (sum.begin (), sum.end ());
+}
+
+bool
+AES_CMAC::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != sum.size ())
+        return false;
+    std::copy (p, p + n, sum.begin ());
+    return true;
 }
 
 void
@@ -72,22 +89,18 @@ AES_CMAC::last_sum ()
     cipher.encrypt (zero, el);
     BLOCK key1 = generate_key (el);
     BLOCK key2 = generate_key (key1);
-    if (mbuf.size () == 16U) {
+    if (mbuflen == 16U) {
         BLOCK w;
-        for (int i = 0; i < 16; ++i) {
-            std::uint8_t const x = static_cast<std::uint8_t> (mbuf[i]);
-            w[i] = sum[i] ^ key1[i] ^ x;
-        }
+        for (int i = 0; i < 16; ++i)
+            w[i] = sum[i] ^ key1[i] ^ mbuf[i];
         cipher.encrypt (w, sum);
     }
     else {
         BLOCK w;
-        mbuf.push_back (0x80);
-        mbuf.resize (16, 0);
-        for (int i = 0; i < 16; ++i) {
-            std::uint8_t const x = static_cast<std::uint8_t> (mbuf[i]);
-            w[i] = sum[i] ^ key2[i] ^ x;
-        }
+        mbuf[mbuflen] = 0x80;
+        std::fill (mbuf + mbuflen + 1, mbuf + 16, 0);
+        for (int i = 0; i < 16; ++i)
+            w[i] = sum[i] ^ key2[i] ^ mbuf[i];
         cipher.encrypt (w, sum);
     }
 }
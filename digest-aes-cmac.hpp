@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <array>
 #include <string>
+#include <memory>
 #include "digest.hpp"
 #include "cipher-aes.hpp"
 
@@ -10,18 +11,27 @@ namespace digest {
 
 class AES_CMAC : public base {
 public:
+    enum { DIGESTSIZE = 16 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     using BLOCK = typename cipher::AES::BLOCK;
 
     AES_CMAC ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new AES_CMAC (*this)); }
     AES_CMAC& set_key128 (std::array<std::uint8_t,16> const& key);
     AES_CMAC& set_key192 (std::array<std::uint8_t,24> const& key);
     AES_CMAC& set_key256 (std::array<std::uint8_t,32> const& key);
     std::size_t blocksize () const { return sum.size (); }
-    std::string digest ();
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
-    void update_sum (std::string::const_iterator s);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
     void last_sum ();
+    bool keeps_last_block () const { return true; }
+    std::uint8_t state_tag () const { return STATE_AES_CMAC; }
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 private:
     cipher::AES cipher;
     BLOCK sum;
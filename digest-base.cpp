@@ -1,6 +1,7 @@
 #include <string>
 #include <cstdint>
 #include <algorithm>
+#include <cstring>
 #include "digest.hpp"
 
 namespace digest {
@@ -9,49 +10,70 @@ base&
 base::reset ()
 {
     mstate = ADD;
-    mbuf.clear ();
+    mbuflen = 0;
     mlen = 0;
     init_sum ();
     return *this;
 }
 
 base&
-base::add (std::string::const_iterator s, std::string::const_iterator e)
+base::add (void const* data, std::size_t size)
 {
     if (ADD != mstate)
         reset ();
-    if (s >= e)
+    if (0 == size)
         return *this;
+    char const* s = static_cast<char const*> (data);
+    char const* const e = s + size;
     std::size_t const blksize = blocksize ();
-    if (mbuf.size () > 0 && mbuf.size () < blksize) {
+    if (mbuflen > 0 && mbuflen < blksize) {
         std::size_t const datasize = e - s;
-        std::size_t const n = std::min (datasize, blksize - mbuf.size ());
-        mbuf.append (s, s + n);
+        std::size_t const n = std::min (datasize, blksize - mbuflen);
+        std::memcpy (mbuf + mbuflen, s, n);
+        mbuflen += n;
         s += n;
         mlen += n;
     }
-    if (mbuf.size () == blksize) {
-        std::string::const_iterator t = mbuf.cbegin ();
-        update_sum (t);
-        mbuf.clear ();
+    // a class treating the final block specially keeps the last full
+    // block in mbuf until more data comes. the others compress it now,
+    // so that a state after whole blocks has an empty mbuf.
+    std::size_t const keep = keeps_last_block () ? 1 : 0;
+    if (mbuflen == blksize && (s < e || 0 == keep)) {
+        update_blocks (mbuf, 1);
+        mbuflen = 0;
     }
     if (s == e)
         return *this;
-    for (; s + blksize < e; s += blksize) {
-        std::string::const_iterator t = s;
-        update_sum (t);
-        mbuf.clear ();
-        mlen += blksize;
+    std::size_t const nblocks = (e - s - keep) / blksize;
+    if (nblocks > 0) {
+        update_blocks (reinterpret_cast<std::uint8_t const*> (s), nblocks);
+        s += nblocks * blksize;
+        mlen += nblocks * blksize;
     }
-    mbuf.assign (s, e);
-    mlen += mbuf.size ();
+    mbuflen = e - s;
+    std::memcpy (mbuf, s, mbuflen);
+    mlen += mbuflen;
     return *this;
 }
 
+base&
+base::add (octets::view const& data)
+{
+    return add (data.data (), data.size ());
+}
+
+base&
+base::add (std::string::const_iterator s, std::string::const_iterator e)
+{
+    if (s >= e)
+        return add (nullptr, 0);
+    return add (&*s, e - s);
+}
+
 base&
 base::add (std::string const& data)
 {
-    return add (data.cbegin (), data.cend ());
+    return add (data.data (), data.size ());
 }
 
 base&
@@ -66,14 +88,83 @@ base::finish ()
     return *this;
 }
 
+// state layout of version 1:
+//      octet 0         STATE_VERSION
+//      octet 1         state_tag ()
+//      octet 2         mstate
+//      octet 3         mbuflen
+//      octets 4..11    mlen in big endian
+//      mbuflen octets  mbuf
+//      the rest        export_sum ()
+std::string
+base::export_state () const
+{
+    std::string state;
+    state.push_back (STATE_VERSION);
+    state.push_back (state_tag ());
+    state.push_back (mstate);
+    state.push_back (mbuflen);
+    pack_state (state, mlen, 8);
+    state.append (reinterpret_cast<char const*> (mbuf), mbuflen);
+    export_sum (state);
+    return state;
+}
+
+bool
+base::import_state (octets::view const& state)
+{
+    std::size_t const HEADSIZE = 12;
+    if (state.size () < HEADSIZE || STATE_VERSION != state[0]
+            || state_tag () != state[1] || state[2] > FINISH)
+        return false;
+    std::size_t const buflen = state[3];
+    if (buflen > blocksize () || buflen > state.size () - HEADSIZE)
+        return false;
+    std::uint8_t const* const p = state.data () + HEADSIZE;
+    if (! import_sum (p + buflen, state.size () - HEADSIZE - buflen))
+        return false;
+    mstate = static_cast<decltype (mstate)> (state[2]);
+    mbuflen = buflen;
+    std::memcpy (mbuf, p, buflen);
+    mlen = unpack_state (state.data () + 4, 8);
+    return true;
+}
+
+void
+base::pack_state (std::string& out, std::uint64_t const x, std::size_t const n)
+{
+    for (std::size_t i = n; i > 0; --i)
+        out.push_back ((x >> (8 * (i - 1))) & 0xff);
+}
+
+std::uint64_t
+base::unpack_state (std::uint8_t const* p, std::size_t const n)
+{
+    std::uint64_t x = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        x = (x << 8) | p[i];
+    return x;
+}
+
+std::string
+base::digest ()
+{
+    std::string octets (digestsize (), 0);
+    digest_into (reinterpret_cast<std::uint8_t*> (&octets[0]));
+    return octets;
+}
+
 std::string
 base::hexdigest ()
 {
-    std::string const octets = digest ();
+    std::uint8_t octets[MAXDIGESTSIZE];
+    std::size_t const n = digestsize ();
+    digest_into (octets);
     std::string hex;
-    for (int x: octets) {
-        unsigned int const hi = (x >> 4) & 0x0f;
-        unsigned int const lo = x & 0x0f;
+    hex.reserve (n * 2);
+    for (std::size_t i = 0; i < n; ++i) {
+        unsigned int const hi = (octets[i] >> 4) & 0x0f;
+        unsigned int const lo = octets[i] & 0x0f;
         hex.push_back (hi < 10 ? hi + '0' : hi + 'a' - 10);
         hex.push_back (lo < 10 ? lo + '0' : lo + 'a' - 10);
     }
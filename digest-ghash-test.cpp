@@ -2,6 +2,7 @@
 #include <string>
 #include <array>
 #include <algorithm>
+#include <memory>
 #include "digest-ghash.hpp"
 #include "mime-base16.hpp"
 #include "taptests.hpp"
@@ -186,10 +187,94 @@ decode_key (std::string const& keyhex)
     return key;
 }
 
+bool
+spec_on_engine (void)
+{
+    bool ok = true;
+    for (std::size_t i = 0; i < NBLOCK; ++i) {
+        digest::GHASH ghash;
+        ghash.set_key128 (decode_key (spec[i].hashkey));
+        ghash.set_authdata (decode_hex (spec[i].authdata));
+        ghash.add (decode_hex (spec[i].ciphertext));
+        ok = ok && ghash.digest () == decode_hex (spec[i].ghashsum);
+    }
+    return ok;
+}
+
+// a long text added in pieces of 1 to 199 octets, so that runs of
+// blocks start and end at any place of the aggregated ones.
+std::string
+long_ghash (std::array<std::uint8_t,16> const& hashkey)
+{
+    std::string authdata (37, 0);
+    std::string text (16 * 1000 + 5, 0);
+    for (std::size_t i = 0; i < authdata.size (); ++i)
+        authdata[i] = static_cast<char> (i * 13 + 1);
+    for (std::size_t i = 0; i < text.size (); ++i)
+        text[i] = static_cast<char> (i * 7 + 3);
+    digest::GHASH ghash;
+    ghash.set_key128 (hashkey);
+    ghash.set_authdata (authdata);
+    for (std::size_t i = 0, n = 0; i < text.size (); i += n) {
+        n = std::min<std::size_t> (1 + i % 199, text.size () - i);
+        ghash.add (text.substr (i, n));
+    }
+    return ghash.digest ();
+}
+
+void
+test_engine (test::simple& ts, digest::GHASH::engine_type const e, char const* name)
+{
+    std::array<std::uint8_t,16> const hashkey = decode_key (spec[17].hashkey);
+    digest::GHASH::select_engine (digest::GHASH::ENGINE_PORTABLE);
+    std::string const expected = long_ghash (hashkey);
+    if (! digest::GHASH::select_engine (e)) {
+        ts.diag (std::string (name) + " engine is not available.");
+        ts.skip (); ts.ok (true, std::string (name) + " test vectors");
+        ts.skip (); ts.ok (true, std::string (name) + " long text same as portable");
+        digest::GHASH::select_engine (digest::GHASH::ENGINE_AUTO);
+        return;
+    }
+    ts.ok (spec_on_engine (), std::string (name) + " test vectors");
+    ts.ok (long_ghash (hashkey) == expected, std::string (name) + " long text same as portable");
+    digest::GHASH::select_engine (digest::GHASH::ENGINE_AUTO);
+}
+
+void
+test_tables (test::simple& ts)
+{
+    std::array<std::uint8_t,16> const hashkey = decode_key (spec[17].hashkey);
+    digest::GHASH::select_engine (digest::GHASH::ENGINE_PORTABLE);
+    digest::GHASH::select_table (digest::GHASH::TABLE_4BIT);
+    std::string const expected = long_ghash (hashkey);
+    digest::GHASH::select_table (digest::GHASH::TABLE_8BIT);
+    ts.ok (spec_on_engine () && long_ghash (hashkey) == expected,
+        "8-bit table same as 4-bit one");
+
+    digest::GHASH::select_table (digest::GHASH::TABLE_AUTO);
+    digest::GHASH::set_table_budget (2 * 4096);
+    {
+        digest::GHASH a, b, c;
+        a.set_key128 (hashkey);
+        b.set_key128 (hashkey);
+        c.set_key128 (hashkey);
+        std::unique_ptr<digest::base> d = a.clone ();
+        ts.ok (digest::GHASH::table_octets_in_use () == 2 * 4096,
+            "8-bit tables within the budget, shared by a clone");
+        std::string const text (100, 'x');
+        std::string const sum = a.add (text).digest ();
+        ts.ok (b.add (text).digest () == sum && c.add (text).digest () == sum
+            && d->add (text).digest () == sum, "4-bit table over the budget");
+    }
+    ts.ok (digest::GHASH::table_octets_in_use () == 0, "8-bit tables released");
+    digest::GHASH::set_table_budget (64 * 1024);
+    digest::GHASH::select_engine (digest::GHASH::ENGINE_AUTO);
+}
+
 int
 main (int argc, char* argv[])
 {
-    test::simple ts (NBLOCK);
+    test::simple ts (NBLOCK * 2 + 10);
     for (int i = 0; i < NBLOCK; ++i) {
         std::array<std::uint8_t,16> const hashkey = decode_key (spec[i].hashkey);
         std::string const authdata = decode_hex (spec[i].authdata);
@@ -202,6 +287,19 @@ main (int argc, char* argv[])
         ghash.add (ciphertext);
 
         ts.ok (ghash.digest () == expected_ghash, "ghash " + std::to_string (i + 1));
+
+        std::size_t const half = ciphertext.size () / 2;
+        ghash.reset ().add (ciphertext.substr (0, half));
+        digest::GHASH resumed;
+        resumed.set_key128 (hashkey);
+        resumed.set_authdata (authdata);
+        ts.ok (resumed.import_state (ghash.export_state ())
+            && resumed.add (ciphertext.substr (half)).digest () == expected_ghash,
+            "ghash " + std::to_string (i + 1) + " import_state");
     }
+    test_engine (ts, digest::GHASH::ENGINE_PORTABLE, "portable");
+    test_engine (ts, digest::GHASH::ENGINE_PCLMUL, "pclmul");
+    test_engine (ts, digest::GHASH::ENGINE_CTMUL64, "ctmul64");
+    test_tables (ts);
     return ts.done_testing ();
 }
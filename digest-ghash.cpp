@@ -3,8 +3,14 @@
 #include <string>
 #include <algorithm>
 #include <utility>
+#include <memory>
+#include <atomic>
 #include "digest.hpp"
 #include "digest-ghash.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
 
 namespace digest {
 
@@ -87,7 +93,398 @@ gfmul (std::array<std::array<std::uint32_t,4>,16> const& a,
     std::swap (c, v);
 }
 
-GHASH::GHASH () : hash_key (), authdata (), sum ()
+// C = A * B in GF(2**128), precomputed A[i] = H * i for i in 0 ... 256
+static void
+gfmul8 (std::array<std::array<std::uint32_t,4>,256> const& a,
+    std::array<std::uint32_t,4> const& b, std::array<std::uint32_t,4>& c)
+{
+    static const std::uint32_t reduction[256] = {
+        0x00000000, 0x01c20000, 0x03840000, 0x02460000, 0x07080000, 0x06ca0000, 0x048c0000, 0x054e0000,
+        0x0e100000, 0x0fd20000, 0x0d940000, 0x0c560000, 0x09180000, 0x08da0000, 0x0a9c0000, 0x0b5e0000,
+        0x1c200000, 0x1de20000, 0x1fa40000, 0x1e660000, 0x1b280000, 0x1aea0000, 0x18ac0000, 0x196e0000,
+        0x12300000, 0x13f20000, 0x11b40000, 0x10760000, 0x15380000, 0x14fa0000, 0x16bc0000, 0x177e0000,
+        0x38400000, 0x39820000, 0x3bc40000, 0x3a060000, 0x3f480000, 0x3e8a0000, 0x3ccc0000, 0x3d0e0000,
+        0x36500000, 0x37920000, 0x35d40000, 0x34160000, 0x31580000, 0x309a0000, 0x32dc0000, 0x331e0000,
+        0x24600000, 0x25a20000, 0x27e40000, 0x26260000, 0x23680000, 0x22aa0000, 0x20ec0000, 0x212e0000,
+        0x2a700000, 0x2bb20000, 0x29f40000, 0x28360000, 0x2d780000, 0x2cba0000, 0x2efc0000, 0x2f3e0000,
+        0x70800000, 0x71420000, 0x73040000, 0x72c60000, 0x77880000, 0x764a0000, 0x740c0000, 0x75ce0000,
+        0x7e900000, 0x7f520000, 0x7d140000, 0x7cd60000, 0x79980000, 0x785a0000, 0x7a1c0000, 0x7bde0000,
+        0x6ca00000, 0x6d620000, 0x6f240000, 0x6ee60000, 0x6ba80000, 0x6a6a0000, 0x682c0000, 0x69ee0000,
+        0x62b00000, 0x63720000, 0x61340000, 0x60f60000, 0x65b80000, 0x647a0000, 0x663c0000, 0x67fe0000,
+        0x48c00000, 0x49020000, 0x4b440000, 0x4a860000, 0x4fc80000, 0x4e0a0000, 0x4c4c0000, 0x4d8e0000,
+        0x46d00000, 0x47120000, 0x45540000, 0x44960000, 0x41d80000, 0x401a0000, 0x425c0000, 0x439e0000,
+        0x54e00000, 0x55220000, 0x57640000, 0x56a60000, 0x53e80000, 0x522a0000, 0x506c0000, 0x51ae0000,
+        0x5af00000, 0x5b320000, 0x59740000, 0x58b60000, 0x5df80000, 0x5c3a0000, 0x5e7c0000, 0x5fbe0000,
+        0xe1000000, 0xe0c20000, 0xe2840000, 0xe3460000, 0xe6080000, 0xe7ca0000, 0xe58c0000, 0xe44e0000,
+        0xef100000, 0xeed20000, 0xec940000, 0xed560000, 0xe8180000, 0xe9da0000, 0xeb9c0000, 0xea5e0000,
+        0xfd200000, 0xfce20000, 0xfea40000, 0xff660000, 0xfa280000, 0xfbea0000, 0xf9ac0000, 0xf86e0000,
+        0xf3300000, 0xf2f20000, 0xf0b40000, 0xf1760000, 0xf4380000, 0xf5fa0000, 0xf7bc0000, 0xf67e0000,
+        0xd9400000, 0xd8820000, 0xdac40000, 0xdb060000, 0xde480000, 0xdf8a0000, 0xddcc0000, 0xdc0e0000,
+        0xd7500000, 0xd6920000, 0xd4d40000, 0xd5160000, 0xd0580000, 0xd19a0000, 0xd3dc0000, 0xd21e0000,
+        0xc5600000, 0xc4a20000, 0xc6e40000, 0xc7260000, 0xc2680000, 0xc3aa0000, 0xc1ec0000, 0xc02e0000,
+        0xcb700000, 0xcab20000, 0xc8f40000, 0xc9360000, 0xcc780000, 0xcdba0000, 0xcffc0000, 0xce3e0000,
+        0x91800000, 0x90420000, 0x92040000, 0x93c60000, 0x96880000, 0x974a0000, 0x950c0000, 0x94ce0000,
+        0x9f900000, 0x9e520000, 0x9c140000, 0x9dd60000, 0x98980000, 0x995a0000, 0x9b1c0000, 0x9ade0000,
+        0x8da00000, 0x8c620000, 0x8e240000, 0x8fe60000, 0x8aa80000, 0x8b6a0000, 0x892c0000, 0x88ee0000,
+        0x83b00000, 0x82720000, 0x80340000, 0x81f60000, 0x84b80000, 0x857a0000, 0x873c0000, 0x86fe0000,
+        0xa9c00000, 0xa8020000, 0xaa440000, 0xab860000, 0xaec80000, 0xaf0a0000, 0xad4c0000, 0xac8e0000,
+        0xa7d00000, 0xa6120000, 0xa4540000, 0xa5960000, 0xa0d80000, 0xa11a0000, 0xa35c0000, 0xa29e0000,
+        0xb5e00000, 0xb4220000, 0xb6640000, 0xb7a60000, 0xb2e80000, 0xb32a0000, 0xb16c0000, 0xb0ae0000,
+        0xbbf00000, 0xba320000, 0xb8740000, 0xb9b60000, 0xbcf80000, 0xbd3a0000, 0xbf7c0000, 0xbebe0000,
+    };
+    std::array<std::uint32_t,4> v = {{0}};
+    for (int k = 3; k >= 0; --k) {
+        std::uint32_t w = b[k];
+        for (int j = 0; j < 32; j += 8) {
+            std::uint32_t overflow = v[3] & 0xff;
+            v[3] = (v[2] << 24) | (v[3] >> 8);
+            v[2] = (v[1] << 24) | (v[2] >> 8);
+            v[1] = (v[0] << 24) | (v[1] >> 8);
+            v[0] = (v[0] >>  8) ^ reduction[overflow];
+            v[3] ^= a[w & 0xff][3];
+            v[2] ^= a[w & 0xff][2];
+            v[1] ^= a[w & 0xff][1];
+            v[0] ^= a[w & 0xff][0];
+            w >>= 8;
+        }
+    }
+    std::swap (c, v);
+}
+
+// the low 64 bits of the carry-less product of X and Y with integer
+// multiplications. each operand keeps one bit in four, so that the
+// carries of a product fall into the holes that the masks clear.
+// no memory access depends on the operands.
+// see T. Pornin, BearSSL ghash_ctmul64.
+static inline std::uint64_t
+bmul64 (std::uint64_t const x, std::uint64_t const y)
+{
+    std::uint64_t const m0 = 0x1111111111111111ULL;
+    std::uint64_t const m1 = 0x2222222222222222ULL;
+    std::uint64_t const m2 = 0x4444444444444444ULL;
+    std::uint64_t const m3 = 0x8888888888888888ULL;
+    std::uint64_t const x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    std::uint64_t const y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+    std::uint64_t const z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    std::uint64_t const z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    std::uint64_t const z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    std::uint64_t const z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+// bit reversal, with which bmul64 gives the high halves of products.
+static inline std::uint64_t
+rev64 (std::uint64_t x)
+{
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+    return (x << 32) | (x >> 32);
+}
+
+static inline std::uint64_t
+gfword64 (std::uint32_t const hi, std::uint32_t const lo)
+{
+    return (static_cast<std::uint64_t> (hi) << 32) | lo;
+}
+
+static inline std::uint64_t
+load64be (std::uint8_t const* p)
+{
+    return (static_cast<std::uint64_t> (p[0]) << 56) | (static_cast<std::uint64_t> (p[1]) << 48)
+        | (static_cast<std::uint64_t> (p[2]) << 40) | (static_cast<std::uint64_t> (p[3]) << 32)
+        | (static_cast<std::uint64_t> (p[4]) << 24) | (static_cast<std::uint64_t> (p[5]) << 16)
+        | (static_cast<std::uint64_t> (p[6]) << 8) | static_cast<std::uint64_t> (p[7]);
+}
+
+// the Karatsuba operands of H, A1, A0, A1+A0 and their reversals.
+static inline void
+gfsplit_ctmul64 (std::array<std::uint32_t,4> const& a, std::array<std::uint64_t,6>& k)
+{
+    k[1] = gfword64 (a[0], a[1]);
+    k[0] = gfword64 (a[2], a[3]);
+    k[2] = k[0] ^ k[1];
+    k[4] = rev64 (k[1]);
+    k[3] = rev64 (k[0]);
+    k[5] = k[3] ^ k[4];
+}
+
+// accumulates the three low and three reversed high halves of the
+// Karatsuba products of X1:X0 and the split H without reduction.
+static inline void
+gfmul_add_ctmul64 (std::array<std::uint64_t,6> const& k,
+    std::uint64_t const x1, std::uint64_t const x0, std::array<std::uint64_t,6>& z)
+{
+    std::uint64_t const x1r = rev64 (x1);
+    std::uint64_t const x0r = rev64 (x0);
+    z[0] ^= bmul64 (x0, k[0]);
+    z[1] ^= bmul64 (x1, k[1]);
+    z[2] ^= bmul64 (x0 ^ x1, k[2]);
+    z[3] ^= bmul64 (x0r, k[3]);
+    z[4] ^= bmul64 (x1r, k[4]);
+    z[5] ^= bmul64 (x0r ^ x1r, k[5]);
+}
+
+// combines the sum of products into 256 bits, shifts it left by one
+// bit for the reflected operands, and reduces it modulo
+// x**128 + x**7 + x**2 + x + 1 into Y1:Y0.
+static inline void
+gfreduce_ctmul64 (std::array<std::uint64_t,6> const& z, std::uint64_t& y1, std::uint64_t& y0)
+{
+    std::uint64_t const z2 = z[2] ^ z[0] ^ z[1];
+    std::uint64_t const z0h = rev64 (z[3]) >> 1;
+    std::uint64_t const z1h = rev64 (z[4]) >> 1;
+    std::uint64_t const z2h = rev64 (z[5] ^ z[3] ^ z[4]) >> 1;
+    std::uint64_t v0 = z[0];
+    std::uint64_t v1 = z0h ^ z2;
+    std::uint64_t v2 = z[1] ^ z2h;
+    std::uint64_t v3 = z1h;
+    v3 = (v3 << 1) | (v2 >> 63);
+    v2 = (v2 << 1) | (v1 >> 63);
+    v1 = (v1 << 1) | (v0 >> 63);
+    v0 = v0 << 1;
+    v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+    v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+    v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+    v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+    y1 = v3;
+    y0 = v2;
+}
+
+static inline void
+gfstore_ctmul64 (std::uint64_t const y1, std::uint64_t const y0, std::array<std::uint32_t,4>& c)
+{
+    c[0] = static_cast<std::uint32_t> (y1 >> 32);
+    c[1] = static_cast<std::uint32_t> (y1);
+    c[2] = static_cast<std::uint32_t> (y0 >> 32);
+    c[3] = static_cast<std::uint32_t> (y0);
+}
+
+// C = A * B in GF(2**128) in constant time
+static void
+gfmul_ctmul64 (std::array<std::uint32_t,4> const& a,
+    std::array<std::uint32_t,4> const& b, std::array<std::uint32_t,4>& c)
+{
+    std::array<std::uint64_t,6> k;
+    std::array<std::uint64_t,6> z = {{0}};
+    std::uint64_t y1, y0;
+    gfsplit_ctmul64 (a, k);
+    gfmul_add_ctmul64 (k, gfword64 (b[0], b[1]), gfword64 (b[2], b[3]), z);
+    gfreduce_ctmul64 (z, y1, y0);
+    gfstore_ctmul64 (y1, y0, c);
+}
+
+// up to eight blocks are multiplied by the powers of H as the PCLMUL
+// engine does, and their products share the bit reversals and the
+// reduction.
+static void
+update_blocks_ctmul64 (std::array<std::array<std::uint32_t,4>,8> const& hash_powers,
+    std::array<std::uint32_t,4>& sum, std::uint8_t const* p, std::size_t nblocks)
+{
+    std::array<std::array<std::uint64_t,6>,8> k;
+    std::size_t const nk = std::min<std::size_t> (8, nblocks);
+    for (std::size_t i = 0; i < nk; ++i)
+        gfsplit_ctmul64 (hash_powers[i], k[i]);
+    std::uint64_t y1 = gfword64 (sum[0], sum[1]);
+    std::uint64_t y0 = gfword64 (sum[2], sum[3]);
+    while (nblocks > 0) {
+        std::size_t const n = std::min<std::size_t> (8, nblocks);
+        std::array<std::uint64_t,6> z = {{0}};
+        for (std::size_t i = 0; i < n; ++i, p += 16) {
+            std::uint64_t x1 = load64be (p);
+            std::uint64_t x0 = load64be (p + 8);
+            if (0 == i) {
+                x1 ^= y1;
+                x0 ^= y0;
+            }
+            gfmul_add_ctmul64 (k[n - 1 - i], x1, x0, z);
+        }
+        gfreduce_ctmul64 (z, y1, y0);
+        nblocks -= n;
+    }
+    gfstore_ctmul64 (y1, y0, sum);
+}
+
+#if defined (CPU_FEATURES_X86)
+
+// the blocks are byte-reflected into 128-bit integers, whose 32-bit
+// lanes from the top are the big-endian words of gfpack. carry-less
+// products of the reflected operands come out shifted right by one bit.
+// see Intel, Carry-Less Multiplication Instruction and its Usage for
+// Computing the GCM Mode.
+
+__attribute__ ((target ("pclmul,ssse3")))
+static inline __m128i
+gfload_pclmul (std::array<std::uint32_t,4> const& a)
+{
+    return _mm_set_epi32 (static_cast<int> (a[0]), static_cast<int> (a[1]),
+        static_cast<int> (a[2]), static_cast<int> (a[3]));
+}
+
+// accumulates the 256-bit product of A and B without reduction.
+__attribute__ ((target ("pclmul,ssse3")))
+static inline void
+gfmul_add_pclmul (__m128i const a, __m128i const b, __m128i& lo, __m128i& mid, __m128i& hi)
+{
+    lo = _mm_xor_si128 (lo, _mm_clmulepi64_si128 (a, b, 0x00));
+    mid = _mm_xor_si128 (mid, _mm_clmulepi64_si128 (a, b, 0x10));
+    mid = _mm_xor_si128 (mid, _mm_clmulepi64_si128 (a, b, 0x01));
+    hi = _mm_xor_si128 (hi, _mm_clmulepi64_si128 (a, b, 0x11));
+}
+
+// shifts the sum of products left by one bit and reduces it modulo
+// x**128 + x**7 + x**2 + x + 1.
+__attribute__ ((target ("pclmul,ssse3")))
+static inline __m128i
+gfreduce_pclmul (__m128i lo, __m128i const mid, __m128i hi)
+{
+    lo = _mm_xor_si128 (lo, _mm_slli_si128 (mid, 8));
+    hi = _mm_xor_si128 (hi, _mm_srli_si128 (mid, 8));
+    __m128i const lc = _mm_srli_epi32 (lo, 31);
+    __m128i const hc = _mm_srli_epi32 (hi, 31);
+    lo = _mm_or_si128 (_mm_slli_epi32 (lo, 1), _mm_slli_si128 (lc, 4));
+    hi = _mm_or_si128 (_mm_slli_epi32 (hi, 1),
+        _mm_or_si128 (_mm_slli_si128 (hc, 4), _mm_srli_si128 (lc, 12)));
+    __m128i const a = _mm_xor_si128 (_mm_xor_si128 (_mm_slli_epi32 (lo, 31),
+        _mm_slli_epi32 (lo, 30)), _mm_slli_epi32 (lo, 25));
+    lo = _mm_xor_si128 (lo, _mm_slli_si128 (a, 12));
+    __m128i const b = _mm_xor_si128 (_mm_xor_si128 (_mm_srli_epi32 (lo, 1),
+        _mm_srli_epi32 (lo, 2)), _mm_srli_epi32 (lo, 7));
+    lo = _mm_xor_si128 (lo, _mm_xor_si128 (b, _mm_srli_si128 (a, 4)));
+    return _mm_xor_si128 (hi, lo);
+}
+
+// X = (X + P[0]) * H**n + P[1] * H**(n-1) + ... + P[n-1] * H
+// with a reduction for all n blocks.
+__attribute__ ((target ("pclmul,ssse3")))
+static inline __m128i
+gfmul_blocks_pclmul (__m128i const* h, __m128i const x, std::uint8_t const* p, int const n)
+{
+    __m128i const bswap = _mm_set_epi8 (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i lo = _mm_setzero_si128 ();
+    __m128i mid = _mm_setzero_si128 ();
+    __m128i hi = _mm_setzero_si128 ();
+    for (int i = 0; i < n; ++i) {
+        __m128i b = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (p + i * 16));
+        b = _mm_shuffle_epi8 (b, bswap);
+        if (0 == i)
+            b = _mm_xor_si128 (b, x);
+        gfmul_add_pclmul (b, h[n - 1 - i], lo, mid, hi);
+    }
+    return gfreduce_pclmul (lo, mid, hi);
+}
+
+__attribute__ ((target ("pclmul,ssse3")))
+static void
+update_blocks_pclmul (std::array<std::array<std::uint32_t,4>,8> const& hash_powers,
+    std::array<std::uint32_t,4>& sum, std::uint8_t const* p, std::size_t nblocks)
+{
+    __m128i h[8];
+    for (int i = 0; i < 8; ++i)
+        h[i] = gfload_pclmul (hash_powers[i]);
+    __m128i x = gfload_pclmul (sum);
+    for (; nblocks >= 8; nblocks -= 8, p += 8 * 16)
+        x = gfmul_blocks_pclmul (h, x, p, 8);
+    if (nblocks > 0)
+        x = gfmul_blocks_pclmul (h, x, p, static_cast<int> (nblocks));
+    std::uint32_t w[4];
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (w), x);
+    sum[0] = w[3];
+    sum[1] = w[2];
+    sum[2] = w[1];
+    sum[3] = w[0];
+}
+
+#endif
+
+static GHASH::engine_type
+detect_engine ()
+{
+    if (cpu::has_pclmul () && cpu::has_ssse3 ())
+        return GHASH::ENGINE_PCLMUL;
+    return GHASH::ENGINE_CTMUL64;
+}
+
+static GHASH::engine_type ghash_engine = detect_engine ();
+
+bool
+GHASH::select_engine (engine_type const e)
+{
+    engine_type const available = detect_engine ();
+    if (ENGINE_AUTO == e)
+        ghash_engine = available;
+    else if (ENGINE_PCLMUL == e && ENGINE_PCLMUL != available)
+        return false;
+    else
+        ghash_engine = e;
+    return true;
+}
+
+GHASH::engine_type
+GHASH::engine ()
+{
+    return ghash_engine;
+}
+
+static GHASH::table_type ghash_table = GHASH::TABLE_AUTO;
+static std::size_t table8_budget = 64 * 1024;
+static std::atomic<std::size_t> table8_in_use (0);
+
+void
+GHASH::select_table (table_type const t)
+{
+    ghash_table = t;
+}
+
+GHASH::table_type
+GHASH::table ()
+{
+    return ghash_table;
+}
+
+void
+GHASH::set_table_budget (std::size_t const octets)
+{
+    table8_budget = octets;
+}
+
+std::size_t
+GHASH::table_octets_in_use ()
+{
+    return table8_in_use;
+}
+
+static void
+unreserve_table8 ()
+{
+    table8_in_use -= sizeof (std::array<std::array<std::uint32_t,4>,256>);
+}
+
+// counts the octets of an 8-bit table against the budget.
+static bool
+reserve_table8 ()
+{
+    std::size_t const n = sizeof (std::array<std::array<std::uint32_t,4>,256>);
+    if (GHASH::TABLE_4BIT == ghash_table)
+        return false;
+    std::size_t const used = table8_in_use.fetch_add (n) + n;
+    if (GHASH::TABLE_AUTO == ghash_table && used > table8_budget) {
+        unreserve_table8 ();
+        return false;
+    }
+    return true;
+}
+
+static void
+release_table8 (std::array<std::array<std::uint32_t,4>,256> const* a)
+{
+    delete a;
+    unreserve_table8 ();
+}
+
+GHASH::GHASH () : hash_key (), hash_key8 (), hash_powers (), authdata (), sum ()
 {
 }
 
@@ -105,6 +502,30 @@ GHASH::set_key128 (std::array<std::uint8_t,16> const& key)
         gftwice (hash_key[revbit[i]]);
         gfadd (h, hash_key[revbit[i]], hash_key[revbit[i + 1]]);
     }
+    hash_powers[0] = h;
+    for (int i = 1; i < 8; ++i)
+        gfmul_ctmul64 (hash_powers[i - 1], h, hash_powers[i]);
+    hash_key8.reset ();
+    // the table is allocated only within the budget, and a failed
+    // allocation gives its reservation back.
+    if (ENGINE_PORTABLE == ghash_engine && reserve_table8 ()) {
+        std::unique_ptr<std::array<std::array<std::uint32_t,4>,256> > a;
+        try {
+            a.reset (new std::array<std::array<std::uint32_t,4>,256>);
+        }
+        catch (...) {
+            unreserve_table8 ();
+            throw;
+        }
+        // H * (hi + lo * x**4) for the octet of the nibbles hi and lo
+        for (int i = 0; i < 256; ++i) {
+            std::array<std::uint32_t,4> lo = hash_key[i & 0x0f];
+            for (int j = 0; j < 4; ++j)
+                gftwice (lo);
+            gfadd (hash_key[i >> 4], lo, (*a)[i]);
+        }
+        hash_key8.reset (a.release (), release_table8);
+    }
     return *this;
 }
 
@@ -115,51 +536,88 @@ GHASH::set_authdata (std::string const& ad)
     return *this;
 }
 
-std::string
-GHASH::digest ()
+void
+GHASH::digest_into (std::uint8_t* out)
 {
     finish ();
-    std::string t (16, 0);
-    gfunpack (sum, t.begin ());
-    return std::move (t);
+    gfunpack (sum, out);
 }
 
 void
 GHASH::init_sum ()
 {
     sum.fill (0);
-    update_sum_with_data (authdata);
+    update_sum_with_data (reinterpret_cast<std::uint8_t const*> (authdata.data ()),
+        authdata.size ());
 }
 
 void
-GHASH::update_sum_with_data (std::string const& data)
+GHASH::update_sum_with_data (std::uint8_t const* s, std::size_t size)
 {
-    int const q = data.size () / 16;
-    int const r = data.size () - q * 16;
-    std::string::const_iterator s = data.cbegin ();
-    for (int i = 0; i < q; ++i, s += 16) {
-        update_sum (s);
-    }
+    std::size_t const q = size / 16;
+    std::size_t const r = size - q * 16;
+    if (q > 0)
+        update_blocks (s, q);
     if (r > 0) {
-        std::string padding (s, data.cend ());
-        padding.resize (16, 0);
-        update_sum (padding.cbegin ());
+        std::uint8_t padding[16] = {0};
+        std::copy (s + q * 16, s + q * 16 + r, padding);
+        update_blocks (padding, 1);
     }
 }
 
 void
-GHASH::update_sum (std::string::const_iterator s)
+GHASH::update_blocks (std::uint8_t const* p, std::size_t nblocks)
 {
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_PCLMUL == ghash_engine) {
+        update_blocks_pclmul (hash_powers, sum, p, nblocks);
+        return;
+    }
+#endif
+    if (ENGINE_CTMUL64 == ghash_engine) {
+        update_blocks_ctmul64 (hash_powers, sum, p, nblocks);
+        return;
+    }
     std::array<std::uint32_t,4> y;
-    gfpack (s, y);
-    gfadd (y, sum, sum);
-    gfmul (hash_key, sum, sum);
+    std::array<std::uint32_t,4> x = sum;
+    if (hash_key8) {
+        for (; nblocks > 0; --nblocks, p += 16) {
+            gfpack (p, y);
+            gfadd (y, x, x);
+            gfmul8 (*hash_key8, x, x);
+        }
+    }
+    else {
+        for (; nblocks > 0; --nblocks, p += 16) {
+            gfpack (p, y);
+            gfadd (y, x, x);
+            gfmul (hash_key, x, x);
+        }
+    }
+    sum = x;
+}
+
+void
+GHASH::export_sum (std::string& out) const
+{
+    for (int i = 0; i < 4; ++i)
+        pack_state (out, sum[i], 4);
+}
+
+bool
+GHASH::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != 4 * 4)
+        return false;
+    for (int i = 0; i < 4; ++i)
+        sum[i] = unpack_state (p + i * 4, 4);
+    return true;
 }
 
 void
 GHASH::last_sum ()
 {
-    update_sum_with_data (mbuf);
+    update_sum_with_data (mbuf, mbuflen);
     std::array<std::uint32_t,4> y;
     std::uint64_t const bitlen_authdata = 8LLU * authdata.size ();
     std::uint64_t const bitlen_textdata = 8LLU * mlen;
@@ -167,8 +625,9 @@ GHASH::last_sum ()
     y[1] = bitlen_authdata & 0xffffffff;
     y[2] = bitlen_textdata >> 32;
     y[3] = bitlen_textdata & 0xffffffff;
-    gfadd (y, sum, sum);
-    gfmul (hash_key, sum, sum);
+    std::uint8_t lengths[16];
+    gfunpack (y, lengths);
+    update_blocks (lengths, 1);
 }
 
 }//namespace digest
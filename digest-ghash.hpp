@@ -3,26 +3,59 @@
 #include <cstdint>
 #include <array>
 #include <string>
+#include <memory>
 #include "digest.hpp"
 
 namespace digest {
 
 class GHASH : public base {
 public:
+    enum { DIGESTSIZE = 16 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
+
+    // multipliers in GF(2**128).
+    // ENGINE_AUTO picks PCLMUL when the cpu has it, and CTMUL64 otherwise,
+    // both in constant time, which multiply eight blocks by the powers
+    // of H before a reduction. CTMUL64 makes carry-less products with
+    // integer multiplications. ENGINE_PORTABLE takes the 4-bit tables.
+    // a key works with any engine.
+    enum engine_type { ENGINE_AUTO, ENGINE_PORTABLE, ENGINE_PCLMUL, ENGINE_CTMUL64 };
+    static bool select_engine (engine_type const e);
+    static engine_type engine ();
+
+    // tables of H for ENGINE_PORTABLE, built at set_key128 under it.
+    // TABLE_4BIT takes 256 octets per key, and TABLE_8BIT 4 KiB more
+    // for about twice the speed. TABLE_AUTO takes the 8-bit tables while
+    // all of them stay within set_table_budget, 64 KiB at first, and the
+    // 4-bit ones after that. copies of an object share its 8-bit table.
+    enum table_type { TABLE_AUTO, TABLE_4BIT, TABLE_8BIT };
+    static void select_table (table_type const t);
+    static table_type table ();
+    static void set_table_budget (std::size_t const octets);
+    static std::size_t table_octets_in_use ();
+
     GHASH ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new GHASH (*this)); }
     GHASH& set_key128 (std::array<std::uint8_t,16> const& key);
     GHASH& set_authdata (std::string const& ad);
     std::size_t blocksize () const { return 16U; }
-    std::string digest ();
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
-    void update_sum (std::string::const_iterator s);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
     void last_sum ();
+    std::uint8_t state_tag () const { return STATE_GHASH; }
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 private:
     std::array<std::array<std::uint32_t,4>,16> hash_key;
+    std::shared_ptr<std::array<std::array<std::uint32_t,4>,256> const> hash_key8;
+    std::array<std::array<std::uint32_t,4>,8> hash_powers;
     std::string authdata;
     std::array<std::uint32_t,4> sum;
-    void update_sum_with_data (std::string const& data);
+    void update_sum_with_data (std::uint8_t const* data, std::size_t size);
 };
 
 }//namespace digest
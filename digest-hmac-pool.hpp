@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <list>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include "digest.hpp"
+
+namespace digest {
+
+// keyed pool of ready HMAC contexts, so that a request of a known key
+// starts from its cached ipad and opad states instead of constructing
+// an HMAC object. the least recently used context goes away when the
+// pool is full. a pool is not thread-safe: use one per thread, as
+// local () does.
+template<class HASH>
+class HMAC_POOL {
+public:
+    explicit HMAC_POOL (std::size_t const capacity = 64)
+        : mcapacity (capacity > 0 ? capacity : 1), mlru (), mindex () {}
+
+    std::size_t size () const { return mindex.size (); }
+    std::size_t capacity () const { return mcapacity; }
+
+    // the context of key_id reset for a new message,
+    // or nullptr when the pool does not hold it.
+    HMAC<HASH>*
+    find (std::string const& key_id)
+    {
+        typename index_type::iterator const it = mindex.find (key_id);
+        if (it == mindex.end ())
+            return nullptr;
+        mlru.splice (mlru.begin (), mlru, it->second);
+        HMAC<HASH>& hmac = it->second->second;
+        hmac.reset ();
+        return &hmac;
+    }
+
+    // the context of key_id, keyed with key when it is not in the pool.
+    // the key is assumed to be the same for the same key_id.
+    HMAC<HASH>&
+    acquire (std::string const& key_id, octets::view const& key)
+    {
+        HMAC<HASH>* const found = find (key_id);
+        if (nullptr != found)
+            return *found;
+        if (mindex.size () >= mcapacity) {
+            // reuse the storage of the least recently used context
+            mindex.erase (mlru.back ().first);
+            mlru.splice (mlru.begin (), mlru, std::prev (mlru.end ()));
+            mlru.front ().first = key_id;
+            mlru.front ().second.set_key (key);
+        }
+        else {
+            mlru.emplace_front (key_id, HMAC<HASH> (HMAC_KEY<HASH> (key)));
+        }
+        mindex[key_id] = mlru.begin ();
+        HMAC<HASH>& hmac = mlru.front ().second;
+        hmac.reset ();
+        return hmac;
+    }
+
+    // drops the context, say when the tenant rotates its key.
+    void
+    erase (std::string const& key_id)
+    {
+        typename index_type::iterator const it = mindex.find (key_id);
+        if (it == mindex.end ())
+            return;
+        mlru.erase (it->second);
+        mindex.erase (it);
+    }
+
+    void
+    clear ()
+    {
+        mindex.clear ();
+        mlru.clear ();
+    }
+
+    // the pool of the calling thread.
+    static HMAC_POOL&
+    local ()
+    {
+        static thread_local HMAC_POOL pool;
+        return pool;
+    }
+
+private:
+    using entry_type = std::pair<std::string, HMAC<HASH>>;
+    using lru_type = std::list<entry_type>;
+    using index_type = std::unordered_map<std::string, typename lru_type::iterator>;
+
+    std::size_t mcapacity;
+    lru_type mlru;
+    index_type mindex;
+};
+
+}//namespace digest
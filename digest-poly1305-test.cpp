@@ -43,6 +43,13 @@ test_poly1305_auth (test::simple& ts)
     poly1305.set_key256 (key);
     std::string got_mac = poly1305.add (msg).digest ();
     ts.ok (expected_mac == got_mac, "2.5.2 poly1305 test vector");
+
+    poly1305.reset ().add (msg.substr (0, 17));
+    digest::POLY1305 resumed;
+    resumed.set_key256 (key);
+    ts.ok (resumed.import_state (poly1305.export_state ())
+        && resumed.add (msg.substr (17)).digest () == expected_mac,
+        "2.5.2 poly1305 import_state");
 }
 
 void
@@ -355,7 +362,7 @@ poly1305_mac_test_vector_11 (test::simple& ts)
 int
 main ()
 {
-    test::simple ts (13);
+    test::simple ts (14);
 
     test_poly1305_auth (ts);
     test_poly1305_aead_construction (ts);
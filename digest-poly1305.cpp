@@ -36,8 +36,9 @@ unpack32 (ITER const s)
         | (ord (s[3]) << 24);
 }
 
+template<class ITER>
 static inline void
-pack32 (std::uint32_t const x, std::string::iterator const s)
+pack32 (std::uint32_t const x, ITER const s)
 {
     s[0] = x & 0xff;
     s[1] = (x >> 8) & 0xff;
@@ -45,8 +46,9 @@ pack32 (std::uint32_t const x, std::string::iterator const s)
     s[3] = (x >> 24) & 0xff;
 }
 
+template<class ITER>
 static inline void
-pack64 (std::uint64_t const x, std::string::iterator const s)
+pack64 (std::uint64_t const x, ITER const s)
 {
     s[0] = x & 0xff;
     s[1] = (x >> 8) & 0xff;
@@ -72,8 +74,9 @@ add128 (std::uint32_t const n0, std::uint32_t const n1,
 }
 
 // to little endian unsigned 128 bit
+template<class ITER>
 static inline void
-pack128 (std::array<std::uint32_t,5> const& a, std::string::iterator t)
+pack128 (std::array<std::uint32_t,5> const& a, ITER t)
 {
     std::array<std::uint32_t,5> b;
     for (int i = 0; i < 5; ++i)
@@ -200,51 +203,73 @@ POLY1305::init_sum ()
 {
     sum.fill (0);
     if (aead_construction && ! authdata.empty ())
-        update_sum_with_data (authdata);
+        update_sum_with_data (reinterpret_cast<std::uint8_t const*> (authdata.data ()),
+            authdata.size ());
 }
 
 void
-POLY1305::update_sum_with_data (std::string const& data)
+POLY1305::update_sum_with_data (std::uint8_t const* s, std::size_t size)
 {
-    int const q = data.size () / 16;
-    int const r = data.size () - q * 16;
-    std::string::const_iterator s = data.cbegin ();
-    for (int i = 0; i < q; ++i, s += 16) {
-        update_sum (s);
-    }
+    std::size_t const q = size / 16;
+    std::size_t const r = size - q * 16;
+    if (q > 0)
+        update_blocks (s, q);
     if (r > 0) {
-        std::string padding (s, data.cend ());
-        padding.resize (16, 0);
-        update_sum (padding.cbegin ());
+        std::uint8_t padding[16] = {0};
+        std::copy (s + q * 16, s + q * 16 + r, padding);
+        update_blocks (padding, 1);
     }
 }
 
 void
-POLY1305::update_sum (std::string::const_iterator s)
+POLY1305::update_blocks (std::uint8_t const* p, std::size_t nblocks)
 {
-    add128 (unpack32 (s), unpack32 (s + 4), unpack32 (s + 8), unpack32 (s + 12), sum);
-    sum[4] += 1U << 24;
-    mul_mod (scale, scale5, sum, poly);
+    std::array<std::uint32_t,5> a = sum;
+    std::array<std::uint64_t,5> c;
+    for (; nblocks > 0; --nblocks, p += 16) {
+        add128 (unpack32 (p), unpack32 (p + 4), unpack32 (p + 8), unpack32 (p + 12), a);
+        a[4] += 1U << 24;
+        mul_mod (scale, scale5, a, c);
+    }
+    sum = a;
+}
+
+// the five limbs of the accumulator, not the key r nor s.
+void
+POLY1305::export_sum (std::string& out) const
+{
+    for (int i = 0; i < 5; ++i)
+        pack_state (out, sum[i], 4);
+}
+
+bool
+POLY1305::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != 5 * 4)
+        return false;
+    for (int i = 0; i < 5; ++i)
+        sum[i] = unpack_state (p + i * 4, 4);
+    return true;
 }
 
 void
 POLY1305::last_sum ()
 {
-    if (mbuf.size () == blocksize () || aead_construction) {
-        update_sum_with_data (mbuf);
+    if (mbuflen == blocksize () || aead_construction) {
+        update_sum_with_data (mbuf, mbuflen);
     }
-    else if (! mbuf.empty ()) {
-        mbuf.push_back (0x01);
-        mbuf.resize (16, 0);
-        std::string::const_iterator const p = mbuf.cbegin ();
+    else if (mbuflen > 0) {
+        mbuf[mbuflen] = 0x01;
+        std::fill (mbuf + mbuflen + 1, mbuf + 16, 0);
+        std::uint8_t const* const p = mbuf;
         add128 (unpack32 (p), unpack32 (p + 4), unpack32 (p + 8), unpack32 (p + 12), sum);
         mul_mod (scale, scale5, sum, poly);
     }
     if (aead_construction) {
-        std::string blk (16, 0);
-        pack64 (authdata.size (), blk.begin ());
-        pack64 (mlen, blk.begin () + 8);
-        update_sum (blk.cbegin ());
+        std::uint8_t blk[16];
+        pack64 (authdata.size (), blk);
+        pack64 (mlen, blk + 8);
+        update_blocks (blk, 1);
     }
     complete_mul_mod (sum);
     std::array<std::uint8_t,16>::const_iterator const s = termination.cbegin ();
@@ -252,13 +277,11 @@ POLY1305::last_sum ()
     full_carry (sum);
 }
 
-std::string
-POLY1305::digest ()
+void
+POLY1305::digest_into (std::uint8_t* out)
 {
     finish ();
-    std::string mac (16, 0);
-    pack128 (sum, mac.begin ());
-    return std::move (mac);
+    pack128 (sum, out);
 }
 
 }//namespace digest
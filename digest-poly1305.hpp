@@ -3,18 +3,24 @@
 #include <cstdint>
 #include <array>
 #include <string>
+#include <memory>
 #include "digest.hpp"
 
 namespace digest {
 
 class POLY1305 : public base {
 public:
+    enum { DIGESTSIZE = 16 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     explicit POLY1305 (void);
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new POLY1305 (*this)); }
     POLY1305& set_key256 (std::array<std::uint8_t,32> const& key);
     POLY1305& set_authdata (std::string const& a);
     POLY1305& set_aead_construction (bool const a);
     std::size_t blocksize () const { return 16U; }
-    std::string digest ();
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     std::string authdata;
     bool aead_construction;
@@ -24,9 +30,12 @@ protected:
     std::array<std::uint32_t,5> scale5;
     std::array<std::uint8_t,16> termination;
     void init_sum ();
-    void update_sum_with_data (std::string const& data);
-    void update_sum (std::string::const_iterator s);
+    void update_sum_with_data (std::uint8_t const* data, std::size_t size);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
     void last_sum ();
+    std::uint8_t state_tag () const { return STATE_POLY1305; }
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 };
 
 }//namespace digest
@@ -1,13 +1,18 @@
 #include <string>
 #include <cstdint>
 #include "digest.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
 
 // SHA-1 implementation
 
 namespace digest {
 
+template<class BUF>
 static inline void
-unpack_big_endian (std::string& t, std::size_t const i, std::uint32_t const x)
+unpack_big_endian (BUF& t, std::size_t const i, std::uint32_t const x)
 {
     t[i + 0] = (x >> 24) & 0xff;    
     t[i + 1] = (x >> 16) & 0xff;
@@ -65,58 +70,139 @@ round2 (
     round (a, b, e, (b & c) | (b & d) | (c & d), k, w);
 }
 
-void
-SHA1::update_sum (std::string::const_iterator s)
+static void
+compress_portable (std::uint32_t *sum, std::uint8_t const *p, std::size_t nblocks)
 {
-    std::uint32_t w[80];
-    std::uint32_t a = sum[0], b = sum[1], c = sum[2], d = sum[3], e = sum[4];
-    for (std::size_t i = 0; i < 16U; i++)
-        w[i] = (static_cast<std::uint8_t>(*s++) << 24)
-             | (static_cast<std::uint8_t>(*s++) << 16)
-             | (static_cast<std::uint8_t>(*s++) <<  8)
-             |  static_cast<std::uint8_t>(*s++);
-    for (std::size_t i = 16U; i < 80U; i++)
-        w[i] = rotate_left (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
-    for (std::size_t i = 0; i < 20; i += 5) {
-        round0 (a, b, c, d, e, 0x5a827999, w[i + 0]);
-        round0 (e, a, b, c, d, 0x5a827999, w[i + 1]);
-        round0 (d, e, a, b, c, 0x5a827999, w[i + 2]);
-        round0 (c, d, e, a, b, 0x5a827999, w[i + 3]);
-        round0 (b, c, d, e, a, 0x5a827999, w[i + 4]);
+    for (; nblocks > 0; --nblocks, p += 64) {
+        std::uint32_t w[80];
+        std::uint32_t a = sum[0], b = sum[1], c = sum[2], d = sum[3], e = sum[4];
+        for (std::size_t i = 0; i < 16U; i++)
+            w[i] = (static_cast<std::uint32_t> (p[i * 4 + 0]) << 24)
+                 | (static_cast<std::uint32_t> (p[i * 4 + 1]) << 16)
+                 | (static_cast<std::uint32_t> (p[i * 4 + 2]) <<  8)
+                 |  static_cast<std::uint32_t> (p[i * 4 + 3]);
+        for (std::size_t i = 16U; i < 80U; i++)
+            w[i] = rotate_left (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        for (std::size_t i = 0; i < 20; i += 5) {
+            round0 (a, b, c, d, e, 0x5a827999, w[i + 0]);
+            round0 (e, a, b, c, d, 0x5a827999, w[i + 1]);
+            round0 (d, e, a, b, c, 0x5a827999, w[i + 2]);
+            round0 (c, d, e, a, b, 0x5a827999, w[i + 3]);
+            round0 (b, c, d, e, a, 0x5a827999, w[i + 4]);
+        }
+        for (std::size_t i = 20; i < 40; i += 5) {
+            round1 (a, b, c, d, e, 0x6ed9eba1, w[i + 0]);
+            round1 (e, a, b, c, d, 0x6ed9eba1, w[i + 1]);
+            round1 (d, e, a, b, c, 0x6ed9eba1, w[i + 2]);
+            round1 (c, d, e, a, b, 0x6ed9eba1, w[i + 3]);
+            round1 (b, c, d, e, a, 0x6ed9eba1, w[i + 4]);
+        }
+        for (std::size_t i = 40; i < 60; i += 5) {
+            round2 (a, b, c, d, e, 0x8f1bbcdc, w[i + 0]);
+            round2 (e, a, b, c, d, 0x8f1bbcdc, w[i + 1]);
+            round2 (d, e, a, b, c, 0x8f1bbcdc, w[i + 2]);
+            round2 (c, d, e, a, b, 0x8f1bbcdc, w[i + 3]);
+            round2 (b, c, d, e, a, 0x8f1bbcdc, w[i + 4]);
+        }
+        for (std::size_t i = 60; i < 80; i += 5) {
+            round1 (a, b, c, d, e, 0xca62c1d6, w[i + 0]);
+            round1 (e, a, b, c, d, 0xca62c1d6, w[i + 1]);
+            round1 (d, e, a, b, c, 0xca62c1d6, w[i + 2]);
+            round1 (c, d, e, a, b, 0xca62c1d6, w[i + 3]);
+            round1 (b, c, d, e, a, 0xca62c1d6, w[i + 4]);
+        }
+        sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d; sum[4] += e;
     }
-    for (std::size_t i = 20; i < 40; i += 5) {
-        round1 (a, b, c, d, e, 0x6ed9eba1, w[i + 0]);
-        round1 (e, a, b, c, d, 0x6ed9eba1, w[i + 1]);
-        round1 (d, e, a, b, c, 0x6ed9eba1, w[i + 2]);
-        round1 (c, d, e, a, b, 0x6ed9eba1, w[i + 3]);
-        round1 (b, c, d, e, a, 0x6ed9eba1, w[i + 4]);
+}
+
+#if defined (CPU_FEATURES_X86)
+
+// Intel SHA extensions: twenty groups of four rounds by sha1rnds4.
+// the round function selector F must be an immediate operand.
+template<int F>
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static inline void
+rounds4_shani (int const i, __m128i& abcd, __m128i& e, __m128i *m, __m128i const e0)
+{
+    if (i >= 4) {
+        __m128i const w = _mm_xor_si128 (
+            _mm_sha1msg1_epu32 (m[i & 3], m[(i + 1) & 3]), m[(i + 2) & 3]);
+        m[i & 3] = _mm_sha1msg2_epu32 (w, m[(i + 3) & 3]);
     }
-    for (std::size_t i = 40; i < 60; i += 5) {
-        round2 (a, b, c, d, e, 0x8f1bbcdc, w[i + 0]);
-        round2 (e, a, b, c, d, 0x8f1bbcdc, w[i + 1]);
-        round2 (d, e, a, b, c, 0x8f1bbcdc, w[i + 2]);
-        round2 (c, d, e, a, b, 0x8f1bbcdc, w[i + 3]);
-        round2 (b, c, d, e, a, 0x8f1bbcdc, w[i + 4]);
+    __m128i const ei = i == 0 ? _mm_add_epi32 (e0, m[0])
+                              : _mm_sha1nexte_epu32 (e, m[i & 3]);
+    e = abcd;
+    abcd = _mm_sha1rnds4_epu32 (abcd, ei, F);
+}
+
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static void
+compress_shani (std::uint32_t *sum, std::uint8_t const *p, std::size_t nblocks)
+{
+    __m128i const bswap = _mm_set_epi64x (
+        0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32 (_mm_loadu_si128 (
+        reinterpret_cast<__m128i const*> (sum)), 0x1b);
+    __m128i e0 = _mm_set_epi32 (static_cast<int> (sum[4]), 0, 0, 0);
+    for (; nblocks > 0; --nblocks, p += 64) {
+        __m128i const abcd_save = abcd;
+        __m128i m[4];
+        for (int i = 0; i < 4; ++i)
+            m[i] = _mm_shuffle_epi8 (_mm_loadu_si128 (
+                reinterpret_cast<__m128i const*> (p + i * 16)), bswap);
+        __m128i e = e0;
+        for (int i = 0; i < 5; ++i)
+            rounds4_shani<0> (i, abcd, e, m, e0);
+        for (int i = 5; i < 10; ++i)
+            rounds4_shani<1> (i, abcd, e, m, e0);
+        for (int i = 10; i < 15; ++i)
+            rounds4_shani<2> (i, abcd, e, m, e0);
+        for (int i = 15; i < 20; ++i)
+            rounds4_shani<3> (i, abcd, e, m, e0);
+        e0 = _mm_sha1nexte_epu32 (e, e0);
+        abcd = _mm_add_epi32 (abcd, abcd_save);
     }
-    for (std::size_t i = 60; i < 80; i += 5) {
-        round1 (a, b, c, d, e, 0xca62c1d6, w[i + 0]);
-        round1 (e, a, b, c, d, 0xca62c1d6, w[i + 1]);
-        round1 (d, e, a, b, c, 0xca62c1d6, w[i + 2]);
-        round1 (c, d, e, a, b, 0xca62c1d6, w[i + 3]);
-        round1 (b, c, d, e, a, 0xca62c1d6, w[i + 4]);
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (sum), _mm_shuffle_epi32 (abcd, 0x1b));
+    sum[4] = static_cast<std::uint32_t> (_mm_extract_epi32 (e0, 3));
+}
+
+#endif
+
+void
+SHA1::update_blocks (std::uint8_t const* p, std::size_t nblocks)
+{
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_SHANI == engine ()) {
+        compress_shani (sum, p, nblocks);
+        return;
     }
-    sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d; sum[4] += e;
+#endif
+    compress_portable (sum, p, nblocks);
 }
 
-std::string
-SHA1::digest ()
+void
+SHA1::export_sum (std::string& out) const
+{
+    for (int i = 0; i < 5; ++i)
+        pack_state (out, sum[i], 4);
+}
+
+bool
+SHA1::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != 5 * 4)
+        return false;
+    for (int i = 0; i < 5; ++i)
+        sum[i] = unpack_state (p + i * 4, 4);
+    return true;
+}
+
+void
+SHA1::digest_into (std::uint8_t* out)
 {
-    std::string octets (20, 0);
     finish ();
-    std::uint32_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 4)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 4)
+        unpack_big_endian (out, i, sum[i / 4]);
 }
 
 }//namespace digest
@@ -1,13 +1,20 @@
 #include <string>
+#include <vector>
 #include <cstdint>
+#include <cstring>
 #include "digest.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
 
 // SHA-256 and SHA-224 implementation
 
 namespace digest {
 
+template<class BUF>
 static inline void
-unpack_big_endian (std::string& t, std::size_t const i, std::uint32_t const x)
+unpack_big_endian (BUF& t, std::size_t const i, std::uint32_t const x)
 {
     t[i + 0] = (x >> 24) & 0xff;    
     t[i + 1] = (x >> 16) & 0xff;
@@ -87,84 +94,433 @@ round (
     h = t0 + t1;
 }
 
+static const std::uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void
+compress_portable (std::uint32_t *sum, std::uint8_t const *p, std::size_t nblocks)
+{
+    for (; nblocks > 0; --nblocks, p += 64) {
+        std::uint32_t w[64];
+        std::uint32_t a = sum[0], b = sum[1], c = sum[2], d = sum[3];
+        std::uint32_t e = sum[4], f = sum[5], g = sum[6], h = sum[7];
+        for (std::size_t i = 0; i < 16U; i++)
+            w[i] = (static_cast<std::uint32_t> (p[i * 4 + 0]) << 24)
+                 | (static_cast<std::uint32_t> (p[i * 4 + 1]) << 16)
+                 | (static_cast<std::uint32_t> (p[i * 4 + 2]) <<  8)
+                 |  static_cast<std::uint32_t> (p[i * 4 + 3]);
+        for (std::size_t i = 16U; i < 64U; i++)
+            w[i] = gamma1 (w[i - 2]) + w[i - 7] + gamma0 (w[i - 15]) + w[i - 16];
+        for (std::size_t i = 0; i < 64; i += 8) {
+            round (a, b, c, d, e, f, g, h, K[i + 0], w[i + 0]);
+            round (h, a, b, c, d, e, f, g, K[i + 1], w[i + 1]);
+            round (g, h, a, b, c, d, e, f, K[i + 2], w[i + 2]);
+            round (f, g, h, a, b, c, d, e, K[i + 3], w[i + 3]);
+            round (e, f, g, h, a, b, c, d, K[i + 4], w[i + 4]);
+            round (d, e, f, g, h, a, b, c, K[i + 5], w[i + 5]);
+            round (c, d, e, f, g, h, a, b, K[i + 6], w[i + 6]);
+            round (b, c, d, e, f, g, h, a, K[i + 7], w[i + 7]);
+        }
+        sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d;
+        sum[4] += e; sum[5] += f; sum[6] += g; sum[7] += h;
+    }
+}
+
+#if defined (CPU_FEATURES_X86)
+
+// Intel SHA extensions. the state is kept as ABEF and CDGH halves
+// that sha256rnds2 expects, and four rounds are done per K group.
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static void
+compress_shani (std::uint32_t *sum, std::uint8_t const *p, std::size_t nblocks)
+{
+    __m128i const bswap = _mm_set_epi64x (
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i t = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (&sum[0]));
+    __m128i state1 = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (&sum[4]));
+    t = _mm_shuffle_epi32 (t, 0xb1);                // CDAB
+    state1 = _mm_shuffle_epi32 (state1, 0x1b);      // EFGH
+    __m128i state0 = _mm_alignr_epi8 (t, state1, 8);    // ABEF
+    state1 = _mm_blend_epi16 (state1, t, 0xf0);     // CDGH
+    for (; nblocks > 0; --nblocks, p += 64) {
+        __m128i const abef = state0;
+        __m128i const cdgh = state1;
+        __m128i m[4];
+        for (int i = 0; i < 16; ++i) {
+            if (i < 4) {
+                m[i] = _mm_shuffle_epi8 (_mm_loadu_si128 (
+                    reinterpret_cast<__m128i const*> (p + i * 16)), bswap);
+            }
+            else {
+                __m128i const w = _mm_add_epi32 (
+                    _mm_sha256msg1_epu32 (m[i & 3], m[(i + 1) & 3]),
+                    _mm_alignr_epi8 (m[(i + 3) & 3], m[(i + 2) & 3], 4));
+                m[i & 3] = _mm_sha256msg2_epu32 (w, m[(i + 3) & 3]);
+            }
+            __m128i kw = _mm_add_epi32 (m[i & 3], _mm_loadu_si128 (
+                reinterpret_cast<__m128i const*> (&K[i * 4])));
+            state1 = _mm_sha256rnds2_epu32 (state1, state0, kw);
+            kw = _mm_shuffle_epi32 (kw, 0x0e);
+            state0 = _mm_sha256rnds2_epu32 (state0, state1, kw);
+        }
+        state0 = _mm_add_epi32 (state0, abef);
+        state1 = _mm_add_epi32 (state1, cdgh);
+    }
+    t = _mm_shuffle_epi32 (state0, 0x1b);           // FEBA
+    state1 = _mm_shuffle_epi32 (state1, 0xb1);      // DCHG
+    state0 = _mm_blend_epi16 (t, state1, 0xf0);     // DCBA
+    state1 = _mm_alignr_epi8 (state1, t, 8);        // HGFE
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (&sum[0]), state0);
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (&sum[4]), state1);
+}
+
+#endif
+
+static SHA2_32BIT::engine_type
+detect_engine ()
+{
+    if (cpu::has_sha () && cpu::has_sse41 () && cpu::has_ssse3 ())
+        return SHA2_32BIT::ENGINE_SHANI;
+    return SHA2_32BIT::ENGINE_PORTABLE;
+}
+
+static SHA2_32BIT::engine_type sha2_32bit_engine = detect_engine ();
+
+bool
+SHA2_32BIT::select_engine (engine_type const e)
+{
+    engine_type const available = detect_engine ();
+    if (ENGINE_AUTO == e)
+        sha2_32bit_engine = available;
+    else if (ENGINE_SHANI == e && ENGINE_SHANI != available)
+        return false;
+    else
+        sha2_32bit_engine = e;
+    return true;
+}
+
+SHA2_32BIT::engine_type
+SHA2_32BIT::engine ()
+{
+    return sha2_32bit_engine;
+}
+
 void
-SHA2_32BIT::update_sum (std::string::const_iterator s)
-{
-    static const std::uint32_t K[64] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
-    std::uint32_t w[64];
-    std::uint32_t a = sum[0], b = sum[1], c = sum[2], d = sum[3];
-    std::uint32_t e = sum[4], f = sum[5], g = sum[6], h = sum[7];
-    for (std::size_t i = 0; i < 16U; i++)
-        w[i] = (static_cast<std::uint8_t>(*s++) << 24)
-             | (static_cast<std::uint8_t>(*s++) << 16)
-             | (static_cast<std::uint8_t>(*s++) <<  8)
-             |  static_cast<std::uint8_t>(*s++);
-    for (std::size_t i = 16U; i < 64U; i++)
-        w[i] = gamma1 (w[i - 2]) + w[i - 7] + gamma0 (w[i - 15]) + w[i - 16];
-    for (std::size_t i = 0; i < 64; i += 8) {
-        round (a, b, c, d, e, f, g, h, K[i + 0], w[i + 0]);
-        round (h, a, b, c, d, e, f, g, K[i + 1], w[i + 1]);
-        round (g, h, a, b, c, d, e, f, K[i + 2], w[i + 2]);
-        round (f, g, h, a, b, c, d, e, K[i + 3], w[i + 3]);
-        round (e, f, g, h, a, b, c, d, K[i + 4], w[i + 4]);
-        round (d, e, f, g, h, a, b, c, K[i + 5], w[i + 5]);
-        round (c, d, e, f, g, h, a, b, K[i + 6], w[i + 6]);
-        round (b, c, d, e, f, g, h, a, K[i + 7], w[i + 7]);
+SHA2_32BIT::update_blocks (std::uint8_t const* p, std::size_t nblocks)
+{
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_SHANI == sha2_32bit_engine) {
+        compress_shani (sum, p, nblocks);
+        return;
     }
-    sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d;
-    sum[4] += e; sum[5] += f; sum[6] += g; sum[7] += h;
+#endif
+    compress_portable (sum, p, nblocks);
 }
 
 void
 SHA2_32BIT::last_sum ()
 {
-    mbuf.push_back (0x80);
-    std::size_t n = (mbuf.size () + 8U + 64U - 1U) / 64U * 64U;
-    mbuf.resize (n, 0);
-    unpack_big_endian (mbuf, n - 8, mlen >> 29);
-    unpack_big_endian (mbuf, n - 4, mlen <<  3);
-    std::string::const_iterator p = mbuf.cbegin ();
-    for (std::size_t i = 0; i < n; i += 64U)
-        update_sum (p);
+    std::uint8_t pad[128] = {0};
+    std::memcpy (pad, mbuf, mbuflen);
+    pad[mbuflen] = 0x80;
+    std::size_t const n = (mbuflen + 1U + 8U + 64U - 1U) / 64U * 64U;
+    unpack_big_endian (pad, n - 8, mlen >> 29);
+    unpack_big_endian (pad, n - 4, mlen <<  3);
+    update_blocks (pad, n / 64U);
+}
+
+void
+SHA2_32BIT::export_sum (std::string& out) const
+{
+    for (int i = 0; i < 8; ++i)
+        pack_state (out, sum[i], 4);
+}
+
+bool
+SHA2_32BIT::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != 8 * 4)
+        return false;
+    for (int i = 0; i < 8; ++i)
+        sum[i] = unpack_state (p + i * 4, 4);
+    return true;
 }
 
-std::string
-SHA256::digest ()
+void
+SHA256::digest_into (std::uint8_t* out)
 {
-    std::string octets (32, 0);
     finish ();
-    std::uint32_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 4)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 4)
+        unpack_big_endian (out, i, sum[i / 4]);
 }
 
-std::string
-SHA224::digest ()
+void
+SHA224::digest_into (std::uint8_t* out)
 {
-    std::string octets (28, 0);
     finish ();
-    std::uint32_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 4)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 4)
+        unpack_big_endian (out, i, sum[i / 4]);
+}
+
+// multi-buffer SHA-256
+//
+// a lane holds one message at a time. the full blocks are read in place
+// from the message and the padded tail, one or two blocks, is copied
+// into the lane. when a lane runs out of blocks, its digest is taken
+// and the next message is loaded, so messages of different lengths
+// keep all eight lanes busy.
+
+static const std::uint32_t SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const std::uint32_t SHA224_IV[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+#if defined (CPU_FEATURES_X86)
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+rotate_right_x8 (__m256i const x, int const n)
+{
+    return _mm256_or_si256 (_mm256_srli_epi32 (x, n), _mm256_slli_epi32 (x, 32 - n));
+}
+
+// transpose eight rows of eight 32 bit words
+__attribute__ ((target ("avx2")))
+static inline void
+transpose_x8 (__m256i *r)
+{
+    __m256i const t0 = _mm256_unpacklo_epi32 (r[0], r[1]);
+    __m256i const t1 = _mm256_unpackhi_epi32 (r[0], r[1]);
+    __m256i const t2 = _mm256_unpacklo_epi32 (r[2], r[3]);
+    __m256i const t3 = _mm256_unpackhi_epi32 (r[2], r[3]);
+    __m256i const t4 = _mm256_unpacklo_epi32 (r[4], r[5]);
+    __m256i const t5 = _mm256_unpackhi_epi32 (r[4], r[5]);
+    __m256i const t6 = _mm256_unpacklo_epi32 (r[6], r[7]);
+    __m256i const t7 = _mm256_unpackhi_epi32 (r[6], r[7]);
+    __m256i const u0 = _mm256_unpacklo_epi64 (t0, t2);
+    __m256i const u1 = _mm256_unpackhi_epi64 (t0, t2);
+    __m256i const u2 = _mm256_unpacklo_epi64 (t1, t3);
+    __m256i const u3 = _mm256_unpackhi_epi64 (t1, t3);
+    __m256i const u4 = _mm256_unpacklo_epi64 (t4, t6);
+    __m256i const u5 = _mm256_unpackhi_epi64 (t4, t6);
+    __m256i const u6 = _mm256_unpacklo_epi64 (t5, t7);
+    __m256i const u7 = _mm256_unpackhi_epi64 (t5, t7);
+    r[0] = _mm256_permute2x128_si256 (u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256 (u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256 (u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256 (u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256 (u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256 (u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256 (u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256 (u3, u7, 0x31);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+compress_avx2_x8 (std::uint32_t state[8][8], std::uint8_t const* const block[8])
+{
+    __m256i const bswap = _mm256_set_epi64x (
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m256i w[16];
+    for (int half = 0; half < 2; ++half) {
+        __m256i *r = &w[half * 8];
+        for (int lane = 0; lane < 8; ++lane)
+            r[lane] = _mm256_loadu_si256 (
+                reinterpret_cast<__m256i const*> (block[lane] + half * 32));
+        transpose_x8 (r);
+        for (int i = 0; i < 8; ++i)
+            r[i] = _mm256_shuffle_epi8 (r[i], bswap);
+    }
+    __m256i s[8];
+    for (int i = 0; i < 8; ++i)
+        s[i] = _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (state[i]));
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            __m256i const w15 = w[(i - 15) & 15];
+            __m256i const w2 = w[(i - 2) & 15];
+            __m256i const g0 = _mm256_xor_si256 (_mm256_xor_si256 (
+                rotate_right_x8 (w15, 7), rotate_right_x8 (w15, 18)),
+                _mm256_srli_epi32 (w15, 3));
+            __m256i const g1 = _mm256_xor_si256 (_mm256_xor_si256 (
+                rotate_right_x8 (w2, 17), rotate_right_x8 (w2, 19)),
+                _mm256_srli_epi32 (w2, 10));
+            w[i & 15] = _mm256_add_epi32 (_mm256_add_epi32 (w[i & 15], g0),
+                _mm256_add_epi32 (w[(i - 7) & 15], g1));
+        }
+        __m256i const s1 = _mm256_xor_si256 (_mm256_xor_si256 (
+            rotate_right_x8 (e, 6), rotate_right_x8 (e, 11)), rotate_right_x8 (e, 25));
+        __m256i const ch = _mm256_xor_si256 (_mm256_and_si256 (e, f),
+            _mm256_andnot_si256 (e, g));
+        __m256i const t0 = _mm256_add_epi32 (_mm256_add_epi32 (h, s1),
+            _mm256_add_epi32 (_mm256_add_epi32 (ch, w[i & 15]),
+                _mm256_set1_epi32 (static_cast<int> (K[i]))));
+        __m256i const s0 = _mm256_xor_si256 (_mm256_xor_si256 (
+            rotate_right_x8 (a, 2), rotate_right_x8 (a, 13)), rotate_right_x8 (a, 22));
+        __m256i const ma = _mm256_or_si256 (_mm256_and_si256 (a, b),
+            _mm256_and_si256 (c, _mm256_or_si256 (a, b)));
+        __m256i const t1 = _mm256_add_epi32 (s0, ma);
+        h = g; g = f; f = e;
+        e = _mm256_add_epi32 (d, t0);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi32 (t0, t1);
+    }
+    s[0] = _mm256_add_epi32 (s[0], a); s[1] = _mm256_add_epi32 (s[1], b);
+    s[2] = _mm256_add_epi32 (s[2], c); s[3] = _mm256_add_epi32 (s[3], d);
+    s[4] = _mm256_add_epi32 (s[4], e); s[5] = _mm256_add_epi32 (s[5], f);
+    s[6] = _mm256_add_epi32 (s[6], g); s[7] = _mm256_add_epi32 (s[7], h);
+    for (int i = 0; i < 8; ++i)
+        _mm256_storeu_si256 (reinterpret_cast<__m256i*> (state[i]), s[i]);
+}
+
+#endif
+
+static void
+compress_lane (std::uint32_t state[8][8], int const lane, std::uint8_t const *p)
+{
+    std::uint32_t h[8];
+    for (int i = 0; i < 8; ++i)
+        h[i] = state[i][lane];
+#if defined (CPU_FEATURES_X86)
+    if (SHA2_32BIT::ENGINE_SHANI == sha2_32bit_engine)
+        compress_shani (h, p, 1);
+    else
+#endif
+        compress_portable (h, p, 1);
+    for (int i = 0; i < 8; ++i)
+        state[i][lane] = h[i];
+}
+
+void
+sha256_compress_x8 (std::uint32_t state[8][8], std::uint8_t const* const block[8])
+{
+#if defined (CPU_FEATURES_X86)
+    static bool const avx2 = cpu::has_avx2 ();
+    if (avx2 && SHA2_32BIT::ENGINE_SHANI != sha2_32bit_engine) {
+        compress_avx2_x8 (state, block);
+        return;
+    }
+#endif
+    for (int lane = 0; lane < 8; ++lane)
+        compress_lane (state, lane, block[lane]);
+}
+
+struct sha256_lane {
+    std::uint8_t const *message;
+    std::size_t index;
+    std::size_t block;
+    std::size_t nfull;
+    std::size_t nblocks;
+    std::uint8_t tail[128];
+
+    void
+    load (std::string const& m, std::size_t const i)
+    {
+        std::size_t const len = m.size ();
+        std::size_t const r = len % 64U;
+        message = reinterpret_cast<std::uint8_t const*> (m.data ());
+        index = i;
+        block = 0;
+        nfull = len / 64U;
+        nblocks = nfull + (r + 1U + 8U > 64U ? 2U : 1U);
+        std::size_t const n = (nblocks - nfull) * 64U;
+        std::memset (tail, 0, n);
+        std::memcpy (tail, message + nfull * 64U, r);
+        tail[r] = 0x80;
+        std::uint64_t const bitlen = static_cast<std::uint64_t> (len) << 3;
+        for (int k = 0; k < 8; ++k)
+            tail[n - 1 - k] = (bitlen >> (k * 8)) & 0xff;
+    }
+
+    std::uint8_t const*
+    current () const
+    {
+        return block < nfull ? message + block * 64U : tail + (block - nfull) * 64U;
+    }
+};
+
+static std::vector<std::string>
+sha2_32bit_multi (std::uint32_t const *iv, std::size_t const digestsize,
+    std::vector<std::string> const& messages)
+{
+    enum { NLANE = 8 };
+    static std::uint8_t const idle[64] = {0};
+    std::vector<std::string> digests (messages.size ());
+    std::uint32_t state[8][8] = {{0}};
+    sha256_lane lane[NLANE];
+    bool busy[NLANE];
+    std::size_t next = 0;
+    int nbusy = 0;
+    for (int j = 0; j < NLANE; ++j) {
+        busy[j] = next < messages.size ();
+        if (! busy[j])
+            continue;
+        lane[j].load (messages[next], next);
+        ++next;
+        ++nbusy;
+        for (int i = 0; i < 8; ++i)
+            state[i][j] = iv[i];
+    }
+    while (nbusy > 0) {
+        std::uint8_t const *block[NLANE];
+        for (int j = 0; j < NLANE; ++j)
+            block[j] = busy[j] ? lane[j].current () : idle;
+        sha256_compress_x8 (state, block);
+        for (int j = 0; j < NLANE; ++j) {
+            if (! busy[j] || ++lane[j].block < lane[j].nblocks)
+                continue;
+            std::string& octets = digests[lane[j].index];
+            octets.assign (digestsize, 0);
+            for (std::size_t i = 0; i < digestsize; i += 4)
+                unpack_big_endian (octets, i, state[i / 4][j]);
+            if (next < messages.size ()) {
+                lane[j].load (messages[next], next);
+                ++next;
+                for (int i = 0; i < 8; ++i)
+                    state[i][j] = iv[i];
+            }
+            else {
+                busy[j] = false;
+                --nbusy;
+            }
+        }
+    }
+    return digests;
+}
+
+std::vector<std::string>
+sha256_multi (std::vector<std::string> const& messages)
+{
+    return sha2_32bit_multi (SHA256_IV, 32U, messages);
+}
+
+std::vector<std::string>
+sha224_multi (std::vector<std::string> const& messages)
+{
+    return sha2_32bit_multi (SHA224_IV, 28U, messages);
 }
 
 }//namespace digest
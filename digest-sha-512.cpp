@@ -1,13 +1,20 @@
 #include <string>
+#include <vector>
 #include <cstdint>
+#include <cstring>
 #include "digest.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <immintrin.h>
+#endif
 
 // SHA-512, SHA-384, SHA-512/224, SHA-512/256 implementation
 
 namespace digest {
 
+template<class BUF>
 static inline void
-unpack_big_endian (std::string& t, std::size_t const i, std::uint64_t const x)
+unpack_big_endian (BUF& t, std::size_t const i, std::uint64_t const x)
 {
     t[i + 0] = (x >> 56) & 0xff;    
     t[i + 1] = (x >> 48) & 0xff;
@@ -93,121 +100,369 @@ round (
     h = t0 + t1;
 }
 
-void
-SHA2_64BIT::update_sum (std::string::const_iterator s)
-{
-    static const std::uint64_t K[80] = {
-        0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
-        0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
-        0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
-        0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
-        0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
-        0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
-        0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
-        0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
-        0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
-        0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
-        0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
-        0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
-        0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
-        0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
-        0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
-        0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
-        0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
-        0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
-        0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
-        0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
-        0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
-        0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
-        0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
-        0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
-        0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
-        0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
-        0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
-    };
-    std::uint64_t w[80];
-    std::uint64_t a = sum[0], b = sum[1], c = sum[2], d = sum[3];
-    std::uint64_t e = sum[4], f = sum[5], g = sum[6], h = sum[7];
-    for (std::size_t i = 0; i < 16U; i++)
-        w[i] = (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 56)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 48)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 40)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 32)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 24)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) << 16)
-             | (static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++)) <<  8)
-             |  static_cast<std::uint64_t> (static_cast<std::uint8_t>(*s++));
-    for (std::size_t i = 16U; i < 80U; i++)
-        w[i] = gamma1 (w[i - 2]) + w[i - 7] + gamma0 (w[i - 15]) + w[i - 16];
-    for (std::size_t i = 0; i < 80U; i += 8U) {
-        round (a, b, c, d, e, f, g, h, K[i + 0], w[i + 0]);
-        round (h, a, b, c, d, e, f, g, K[i + 1], w[i + 1]);
-        round (g, h, a, b, c, d, e, f, K[i + 2], w[i + 2]);
-        round (f, g, h, a, b, c, d, e, K[i + 3], w[i + 3]);
-        round (e, f, g, h, a, b, c, d, K[i + 4], w[i + 4]);
-        round (d, e, f, g, h, a, b, c, K[i + 5], w[i + 5]);
-        round (c, d, e, f, g, h, a, b, K[i + 6], w[i + 6]);
-        round (b, c, d, e, f, g, h, a, K[i + 7], w[i + 7]);
+static const std::uint64_t K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static void
+compress_portable (std::uint64_t *sum, std::uint8_t const *p, std::size_t nblocks)
+{
+    for (; nblocks > 0; --nblocks, p += 128) {
+        std::uint64_t w[80];
+        std::uint64_t a = sum[0], b = sum[1], c = sum[2], d = sum[3];
+        std::uint64_t e = sum[4], f = sum[5], g = sum[6], h = sum[7];
+        for (std::size_t i = 0; i < 16U; i++) {
+            std::uint64_t x = 0;
+            for (std::size_t j = 0; j < 8U; j++)
+                x = (x << 8) | p[i * 8 + j];
+            w[i] = x;
+        }
+        for (std::size_t i = 16U; i < 80U; i++)
+            w[i] = gamma1 (w[i - 2]) + w[i - 7] + gamma0 (w[i - 15]) + w[i - 16];
+        for (std::size_t i = 0; i < 80U; i += 8U) {
+            round (a, b, c, d, e, f, g, h, K[i + 0], w[i + 0]);
+            round (h, a, b, c, d, e, f, g, K[i + 1], w[i + 1]);
+            round (g, h, a, b, c, d, e, f, K[i + 2], w[i + 2]);
+            round (f, g, h, a, b, c, d, e, K[i + 3], w[i + 3]);
+            round (e, f, g, h, a, b, c, d, K[i + 4], w[i + 4]);
+            round (d, e, f, g, h, a, b, c, K[i + 5], w[i + 5]);
+            round (c, d, e, f, g, h, a, b, K[i + 6], w[i + 6]);
+            round (b, c, d, e, f, g, h, a, K[i + 7], w[i + 7]);
+        }
+        sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d;
+        sum[4] += e; sum[5] += f; sum[6] += g; sum[7] += h;
     }
-    sum[0] += a; sum[1] += b; sum[2] += c; sum[3] += d;
-    sum[4] += e; sum[5] += f; sum[6] += g; sum[7] += h;
+}
+
+void
+SHA2_64BIT::update_blocks (std::uint8_t const* p, std::size_t nblocks)
+{
+    compress_portable (sum, p, nblocks);
 }
 
 void
 SHA2_64BIT::last_sum ()
 {
-    mbuf.push_back (0x80);
-    std::size_t n = (mbuf.size () + 8U + 128U - 1U) / 128U * 128U;
-    mbuf.resize (n, 0);
+    std::uint8_t pad[256] = {0};
+    std::memcpy (pad, mbuf, mbuflen);
+    pad[mbuflen] = 0x80;
+    std::size_t const n = (mbuflen + 1U + 16U + 128U - 1U) / 128U * 128U;
     std::uint64_t bitlen = static_cast<std::uint64_t> (mlen) << 3;
-    unpack_big_endian (mbuf, n - 8, bitlen);
-    std::string::const_iterator p = mbuf.cbegin ();
-    for (std::size_t i = 0; i < n; i += 128U)
-        update_sum (p);
+    unpack_big_endian (pad, n - 8, bitlen);
+    update_blocks (pad, n / 128U);
+}
+
+void
+SHA2_64BIT::export_sum (std::string& out) const
+{
+    for (int i = 0; i < 8; ++i)
+        pack_state (out, sum[i], 8);
+}
+
+bool
+SHA2_64BIT::import_sum (std::uint8_t const* p, std::size_t n)
+{
+    if (n != 8 * 8)
+        return false;
+    for (int i = 0; i < 8; ++i)
+        sum[i] = unpack_state (p + i * 8, 8);
+    return true;
 }
 
-std::string
-SHA512::digest ()
+void
+SHA512::digest_into (std::uint8_t* out)
 {
-    std::string octets (64, 0);
     finish ();
-    std::uint64_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 8)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 8)
+        unpack_big_endian (out, i, sum[i / 8]);
 }
 
-std::string
-SHA384::digest ()
+void
+SHA384::digest_into (std::uint8_t* out)
 {
-    std::string octets (48, 0);
     finish ();
-    std::uint64_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 8)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 8)
+        unpack_big_endian (out, i, sum[i / 8]);
 }
 
-std::string
-SHA512_224::digest ()
+// SHA-512/224 ends in the middle of sum[3].
+void
+SHA512_224::digest_into (std::uint8_t* out)
 {
-    std::string octets (32, 0);
     finish ();
-    std::uint64_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 8)
-        unpack_big_endian (octets, i, *p++);
-    return octets.substr (0, 28);
+    for (std::size_t i = 0; i < 24; i += 8)
+        unpack_big_endian (out, i, sum[i / 8]);
+    out[24] = (sum[3] >> 56) & 0xff;
+    out[25] = (sum[3] >> 48) & 0xff;
+    out[26] = (sum[3] >> 40) & 0xff;
+    out[27] = (sum[3] >> 32) & 0xff;
 }
 
-std::string
-SHA512_256::digest ()
+void
+SHA512_256::digest_into (std::uint8_t* out)
 {
-    std::string octets (32, 0);
     finish ();
-    std::uint64_t *p = sum;
-    for (std::size_t i = 0; i < octets.size (); i += 8)
-        unpack_big_endian (octets, i, *p++);
-    return octets;
+    for (std::size_t i = 0; i < DIGESTSIZE; i += 8)
+        unpack_big_endian (out, i, sum[i / 8]);
+}
+
+// multi-buffer SHA-512
+//
+// the same lane scheduling as the multi-buffer SHA-256, with four
+// lanes of 64 bit words. SHA-384, SHA-512/224 and SHA-512/256 differ
+// only in the initial value and the size of the result.
+
+static const std::uint64_t SHA512_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const std::uint64_t SHA384_IV[8] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+    0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+    0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+};
+
+#if defined (CPU_FEATURES_X86)
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+rotate_right_x4 (__m256i const x, int const n)
+{
+    return _mm256_or_si256 (_mm256_srli_epi64 (x, n), _mm256_slli_epi64 (x, 64 - n));
+}
+
+// transpose four rows of four 64 bit words
+__attribute__ ((target ("avx2")))
+static inline void
+transpose_x4 (__m256i *r)
+{
+    __m256i const t0 = _mm256_unpacklo_epi64 (r[0], r[1]);
+    __m256i const t1 = _mm256_unpackhi_epi64 (r[0], r[1]);
+    __m256i const t2 = _mm256_unpacklo_epi64 (r[2], r[3]);
+    __m256i const t3 = _mm256_unpackhi_epi64 (r[2], r[3]);
+    r[0] = _mm256_permute2x128_si256 (t0, t2, 0x20);
+    r[1] = _mm256_permute2x128_si256 (t1, t3, 0x20);
+    r[2] = _mm256_permute2x128_si256 (t0, t2, 0x31);
+    r[3] = _mm256_permute2x128_si256 (t1, t3, 0x31);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+compress_avx2_x4 (std::uint64_t state[8][4], std::uint8_t const* const block[4])
+{
+    __m256i const bswap = _mm256_set_epi64x (
+        0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+        0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+    __m256i w[16];
+    for (int quarter = 0; quarter < 4; ++quarter) {
+        __m256i *r = &w[quarter * 4];
+        for (int lane = 0; lane < 4; ++lane)
+            r[lane] = _mm256_loadu_si256 (
+                reinterpret_cast<__m256i const*> (block[lane] + quarter * 32));
+        transpose_x4 (r);
+        for (int i = 0; i < 4; ++i)
+            r[i] = _mm256_shuffle_epi8 (r[i], bswap);
+    }
+    __m256i s[8];
+    for (int i = 0; i < 8; ++i)
+        s[i] = _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (state[i]));
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+    __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 80; ++i) {
+        if (i >= 16) {
+            __m256i const w15 = w[(i - 15) & 15];
+            __m256i const w2 = w[(i - 2) & 15];
+            __m256i const g0 = _mm256_xor_si256 (_mm256_xor_si256 (
+                rotate_right_x4 (w15, 1), rotate_right_x4 (w15, 8)),
+                _mm256_srli_epi64 (w15, 7));
+            __m256i const g1 = _mm256_xor_si256 (_mm256_xor_si256 (
+                rotate_right_x4 (w2, 19), rotate_right_x4 (w2, 61)),
+                _mm256_srli_epi64 (w2, 6));
+            w[i & 15] = _mm256_add_epi64 (_mm256_add_epi64 (w[i & 15], g0),
+                _mm256_add_epi64 (w[(i - 7) & 15], g1));
+        }
+        __m256i const s1 = _mm256_xor_si256 (_mm256_xor_si256 (
+            rotate_right_x4 (e, 14), rotate_right_x4 (e, 18)), rotate_right_x4 (e, 41));
+        __m256i const ch = _mm256_xor_si256 (_mm256_and_si256 (e, f),
+            _mm256_andnot_si256 (e, g));
+        __m256i const t0 = _mm256_add_epi64 (_mm256_add_epi64 (h, s1),
+            _mm256_add_epi64 (_mm256_add_epi64 (ch, w[i & 15]),
+                _mm256_set1_epi64x (static_cast<long long> (K[i]))));
+        __m256i const s0 = _mm256_xor_si256 (_mm256_xor_si256 (
+            rotate_right_x4 (a, 28), rotate_right_x4 (a, 34)), rotate_right_x4 (a, 39));
+        __m256i const ma = _mm256_or_si256 (_mm256_and_si256 (a, b),
+            _mm256_and_si256 (c, _mm256_or_si256 (a, b)));
+        __m256i const t1 = _mm256_add_epi64 (s0, ma);
+        h = g; g = f; f = e;
+        e = _mm256_add_epi64 (d, t0);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi64 (t0, t1);
+    }
+    s[0] = _mm256_add_epi64 (s[0], a); s[1] = _mm256_add_epi64 (s[1], b);
+    s[2] = _mm256_add_epi64 (s[2], c); s[3] = _mm256_add_epi64 (s[3], d);
+    s[4] = _mm256_add_epi64 (s[4], e); s[5] = _mm256_add_epi64 (s[5], f);
+    s[6] = _mm256_add_epi64 (s[6], g); s[7] = _mm256_add_epi64 (s[7], h);
+    for (int i = 0; i < 8; ++i)
+        _mm256_storeu_si256 (reinterpret_cast<__m256i*> (state[i]), s[i]);
+}
+
+#endif
+
+void
+sha512_compress_x4 (std::uint64_t state[8][4], std::uint8_t const* const block[4])
+{
+#if defined (CPU_FEATURES_X86)
+    static bool const avx2 = cpu::has_avx2 ();
+    if (avx2) {
+        compress_avx2_x4 (state, block);
+        return;
+    }
+#endif
+    for (int lane = 0; lane < 4; ++lane) {
+        std::uint64_t h[8];
+        for (int i = 0; i < 8; ++i)
+            h[i] = state[i][lane];
+        compress_portable (h, block[lane], 1);
+        for (int i = 0; i < 8; ++i)
+            state[i][lane] = h[i];
+    }
+}
+
+struct sha512_lane {
+    std::uint8_t const *message;
+    std::size_t index;
+    std::size_t block;
+    std::size_t nfull;
+    std::size_t nblocks;
+    std::uint8_t tail[256];
+
+    void
+    load (std::string const& m, std::size_t const i)
+    {
+        std::size_t const len = m.size ();
+        std::size_t const r = len % 128U;
+        message = reinterpret_cast<std::uint8_t const*> (m.data ());
+        index = i;
+        block = 0;
+        nfull = len / 128U;
+        nblocks = nfull + (r + 1U + 16U > 128U ? 2U : 1U);
+        std::size_t const n = (nblocks - nfull) * 128U;
+        std::memset (tail, 0, n);
+        std::memcpy (tail, message + nfull * 128U, r);
+        tail[r] = 0x80;
+        std::uint64_t const bitlen = static_cast<std::uint64_t> (len) << 3;
+        for (int k = 0; k < 8; ++k)
+            tail[n - 1 - k] = (bitlen >> (k * 8)) & 0xff;
+    }
+
+    std::uint8_t const*
+    current () const
+    {
+        return block < nfull ? message + block * 128U : tail + (block - nfull) * 128U;
+    }
+};
+
+static std::vector<std::string>
+sha2_64bit_multi (std::uint64_t const *iv, std::size_t const digestsize,
+    std::vector<std::string> const& messages)
+{
+    enum { NLANE = 4 };
+    static std::uint8_t const idle[128] = {0};
+    std::vector<std::string> digests (messages.size ());
+    std::uint64_t state[8][4] = {{0}};
+    sha512_lane lane[NLANE];
+    bool busy[NLANE];
+    std::size_t next = 0;
+    int nbusy = 0;
+    for (int j = 0; j < NLANE; ++j) {
+        busy[j] = next < messages.size ();
+        if (! busy[j])
+            continue;
+        lane[j].load (messages[next], next);
+        ++next;
+        ++nbusy;
+        for (int i = 0; i < 8; ++i)
+            state[i][j] = iv[i];
+    }
+    while (nbusy > 0) {
+        std::uint8_t const *block[NLANE];
+        for (int j = 0; j < NLANE; ++j)
+            block[j] = busy[j] ? lane[j].current () : idle;
+        sha512_compress_x4 (state, block);
+        for (int j = 0; j < NLANE; ++j) {
+            if (! busy[j] || ++lane[j].block < lane[j].nblocks)
+                continue;
+            std::string octets (64, 0);
+            for (std::size_t i = 0; i < 64U; i += 8)
+                unpack_big_endian (octets, i, state[i / 8][j]);
+            digests[lane[j].index].assign (octets, 0, digestsize);
+            if (next < messages.size ()) {
+                lane[j].load (messages[next], next);
+                ++next;
+                for (int i = 0; i < 8; ++i)
+                    state[i][j] = iv[i];
+            }
+            else {
+                busy[j] = false;
+                --nbusy;
+            }
+        }
+    }
+    return digests;
+}
+
+std::vector<std::string>
+sha512_multi (std::vector<std::string> const& messages)
+{
+    return sha2_64bit_multi (SHA512_IV, 64U, messages);
+}
+
+std::vector<std::string>
+sha384_multi (std::vector<std::string> const& messages)
+{
+    return sha2_64bit_multi (SHA384_IV, 48U, messages);
+}
+
+std::vector<std::string>
+sha512_224_multi (std::vector<std::string> const& messages)
+{
+    return sha2_64bit_multi (SHA512_IV, 28U, messages);
+}
+
+std::vector<std::string>
+sha512_256_multi (std::vector<std::string> const& messages)
+{
+    return sha2_64bit_multi (SHA512_IV, 32U, messages);
 }
 
 }//namespace digest
@@ -1,12 +1,39 @@
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdlib>
+#include <new>
 #include "digest.hpp"
+#include "digest-hmac-pool.hpp"
 #include "mime-base64.hpp"
 #include "mime-base32.hpp"
 #include "mime-base16.hpp"
 #include "pkcs5-pbkdf2.hpp"
+#include "rfc5869-hkdf.hpp"
 #include "taptests.hpp"
 
+// counts heap allocations to check the allocation-free digest path.
+static std::size_t allocation_count = 0;
+
+void*
+operator new (std::size_t size)
+{
+    ++allocation_count;
+    void* p = std::malloc (size > 0 ? size : 1);
+    if (nullptr == p)
+        throw std::bad_alloc ();
+    return p;
+}
+
+// kept out of line, or gcc pairs the inlined free with operator new.
+__attribute__ ((noinline)) void
+operator delete (void* p) noexcept
+{
+    std::free (p);
+}
+
 void
 test_sha256 (test::simple& t)
 {
@@ -83,6 +110,52 @@ test_sha512 (test::simple& t)
         "sha-512 d");
 }
 
+void
+test_sha512_padding (test::simple& t)
+{
+    // the padding overflows into the second block after 111 octets
+    digest::SHA512 sha512;
+    t.ok (sha512.add (std::string (112, 'a')).hexdigest () ==
+        "c01d080efd492776a1c43bd23dd99d0a2e626d481e16782e75d54c2503b5dc32"
+        "bd05f0f1ba33e568b88fd2d970929b719ecbb152f58f130a407c8830604b70ca",
+        "sha-512 112 octets");
+
+    digest::SHA384 sha384;
+    t.ok (sha384.add (std::string (120, 'a')).hexdigest () ==
+        "ca2f7755efa04d43651f9bcb466044511102e472c2a3981c"
+        "836b487ee4508ca8461f8c396653123400762de4d6d17e63",
+        "sha-384 120 octets");
+}
+
+template<class HASH>
+static bool
+same_as_multi (std::vector<std::string> const& messages,
+    std::vector<std::string> const& got)
+{
+    bool ok = got.size () == messages.size ();
+    for (std::size_t i = 0; ok && i < messages.size (); ++i) {
+        HASH h;
+        ok = got[i] == h.add (messages[i]).digest ();
+    }
+    return ok;
+}
+
+void
+test_sha512_multi (test::simple& t)
+{
+    std::vector<std::string> messages;
+    for (std::size_t n = 0; n < 600; n += 13)
+        messages.push_back (std::string (n, 'a' + n % 26));
+    t.ok (same_as_multi<digest::SHA512> (messages, digest::sha512_multi (messages)),
+        "sha512_multi");
+    t.ok (same_as_multi<digest::SHA384> (messages, digest::sha384_multi (messages)),
+        "sha384_multi");
+    t.ok (same_as_multi<digest::SHA512_224> (messages, digest::sha512_224_multi (messages)),
+        "sha512_224_multi");
+    t.ok (same_as_multi<digest::SHA512_256> (messages, digest::sha512_256_multi (messages)),
+        "sha512_256_multi");
+}
+
 void
 test_sha224 (test::simple& t)
 {
@@ -150,6 +223,57 @@ test_sha1 (test::simple& t)
         "sha-1 quick brown...");
 }
 
+void
+test_sha_padding (test::simple& t)
+{
+    // the padding overflows into the second block after 55 octets
+    std::string const a56 (56, 'a');
+    digest::SHA256 sha256;
+    t.ok (sha256.add (a56).hexdigest () ==
+        "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a",
+        "sha-256 56 octets");
+
+    digest::SHA224 sha224;
+    t.ok (sha224.add (a56).hexdigest () ==
+        "d40854fc9caf172067136f2e29e1380b14626bf6f0dd06779f820dcd",
+        "sha-224 56 octets");
+
+    digest::SHA1 sha1;
+    t.ok (sha1.add (a56).hexdigest () ==
+        "c2db330f6083854c99d4b5bfb6e8f29f201be699",
+        "sha-1 56 octets");
+
+    // FIPS 180-2 one million repetitions of 'a'
+    std::string const million_a (1000000, 'a');
+    t.ok (sha256.add (million_a).hexdigest () ==
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+        "sha-256 million a");
+
+    t.ok (sha1.add (million_a).hexdigest () ==
+        "34aa973cd4c4daa4f61eeb2bdbad27316534016f",
+        "sha-1 million a");
+}
+
+void
+test_sha256_multi (test::simple& t)
+{
+    std::vector<std::string> messages;
+    for (std::size_t n = 0; n < 300; n += 7)
+        messages.push_back (std::string (n, 'a' + n % 26));
+    std::vector<std::string> const got256 = digest::sha256_multi (messages);
+    std::vector<std::string> const got224 = digest::sha224_multi (messages);
+    bool ok256 = got256.size () == messages.size ();
+    bool ok224 = got224.size () == messages.size ();
+    for (std::size_t i = 0; i < messages.size (); ++i) {
+        digest::SHA256 sha256;
+        digest::SHA224 sha224;
+        ok256 = ok256 && got256[i] == sha256.add (messages[i]).digest ();
+        ok224 = ok224 && got224[i] == sha224.add (messages[i]).digest ();
+    }
+    t.ok (ok256, "sha256_multi");
+    t.ok (ok224, "sha224_multi");
+}
+
 void
 test_hmac_1 (test::simple& t)
 {
@@ -941,18 +1065,405 @@ test_pbkdf2_sha256 (test::simple& t)
     t.ok (got == expected, "pbkdf2-sha256 encrypt salt");
 }
 
-int
-main ()
+void
+test_octets_view (test::simple& t)
+{
+    static const std::string abc = "abc";
+    static const std::string expected
+        = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    std::vector<std::uint8_t> const vec (abc.cbegin (), abc.cend ());
+    std::array<std::uint8_t,3> const ary {{'a', 'b', 'c'}};
+
+    t.ok (digest::SHA256 ().add (abc.data (), abc.size ()).hexdigest () == expected,
+        "sha256 add pointer");
+    t.ok (digest::SHA256 ().add (vec).hexdigest () == expected,
+        "sha256 add vector");
+    t.ok (digest::SHA256 ().add (ary).hexdigest () == expected,
+        "sha256 add array");
+
+    // RFC 4231 test case 2
+    static const std::string key = "Jefe";
+    static const std::string data = "what do ya want for nothing?";
+    digest::HMAC<digest::SHA256> hmac (key);
+    hmac.add (data.data (), 10).add (octets::view (data).subview (10));
+    t.ok (hmac.hexdigest ()
+        == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+        "hmac-sha256 add pointer and view");
+}
+
+template<class HASH>
+static bool
+digest_without_allocation (std::string const& data, typename HASH::DIGEST& out)
+{
+    HASH hash;
+    hash.add (data).digest ();
+    std::size_t const before = allocation_count;
+    hash.reset ();
+    hash.add (data.data (), data.size ());
+    hash.digest_into (out.data ());
+    return allocation_count == before;
+}
+
+void
+test_digest_into (test::simple& t)
+{
+    static const std::string abc = "abc";
+    digest::SHA1::DIGEST sha1;
+    digest::SHA256::DIGEST sha256;
+    digest::SHA512::DIGEST sha512;
+
+    t.ok (digest_without_allocation<digest::SHA1> (abc, sha1),
+        "sha1 digest_into without allocation");
+    t.ok (digest_without_allocation<digest::SHA256> (abc, sha256),
+        "sha256 digest_into without allocation");
+    t.ok (digest_without_allocation<digest::SHA512> (abc, sha512),
+        "sha512 digest_into without allocation");
+    t.ok (std::string (sha256.begin (), sha256.end ())
+        == digest::SHA256 ().add (abc).digest (), "sha256 digest_into");
+    digest::SHA512_224 sha512_224;
+    sha512_224.add (abc);
+    digest::SHA512_224::DIGEST const got = sha512_224.digest_array ();
+    t.ok (std::string (got.begin (), got.end ())
+        == digest::SHA512_224 ().add (abc).digest (), "sha512/224 digest_array");
+}
+
+// hashes the head, moves the state to a new object, and hashes the tail.
+template<class HASH>
+static bool
+resume_from_state (HASH& fresh, HASH& hash, std::string const& data, std::size_t const split)
+{
+    std::string const expected = hash.add (data).digest ();
+    hash.reset ().add (data.substr (0, split));
+    if (! fresh.import_state (hash.export_state ()))
+        return false;
+    return fresh.add (data.substr (split)).digest () == expected;
+}
+
+void
+test_export_state (test::simple& t)
+{
+    std::string data;
+    for (int i = 0; i < 1000; ++i)
+        data.push_back (i * 7 + 3);
+
+    {
+        digest::SHA1 a, b;
+        t.ok (resume_from_state (a, b, data, 333), "sha1 resume from state");
+    }
+    {
+        digest::SHA224 a, b;
+        t.ok (resume_from_state (a, b, data, 64), "sha224 resume from state");
+    }
+    {
+        digest::SHA256 a, b;
+        t.ok (resume_from_state (a, b, data, 500), "sha256 resume from state");
+    }
+    {
+        digest::SHA384 a, b;
+        t.ok (resume_from_state (a, b, data, 129), "sha384 resume from state");
+    }
+    {
+        digest::SHA512 a, b;
+        t.ok (resume_from_state (a, b, data, 777), "sha512 resume from state");
+    }
+    {
+        digest::SHA512_256 a, b;
+        t.ok (resume_from_state (a, b, data, 1), "sha512/256 resume from state");
+    }
+    {
+        digest::HMAC<digest::SHA256> a ("key"), b ("key");
+        t.ok (resume_from_state (a, b, data, 100), "hmac-sha256 resume from state");
+    }
+    {
+        digest::HMAC<digest::SHA512> a ("key"), b ("key");
+        t.ok (resume_from_state (a, b, data, 200), "hmac-sha512 resume from state");
+    }
+
+    digest::SHA256 sha256;
+    sha256.add (data);
+    std::string const state = sha256.export_state ();
+    digest::SHA512_256 sha512_256;
+    t.ok (! sha512_256.import_state (state), "sha512/256 rejects sha256 state");
+    t.ok (! digest::SHA256 ().import_state (state.substr (0, state.size () - 1)),
+        "sha256 rejects short state");
+    digest::HMAC<digest::SHA1> hmac_sha1 ("key");
+    t.ok (! hmac_sha1.import_state (state), "hmac rejects sha256 state");
+}
+
+void
+test_hmac_key (test::simple& t)
 {
-    test::simple t (162);
+    // RFC 4231 test case 6, the key is longer than the block
+    std::string key, data;
+    mime::decode_hex (std::string (262, 'a'), key);
+    mime::decode_hex (
+        "54657374205573696e67204c61726765"
+        "72205468616e20426c6f636b2d53697a"
+        "65204b6579202d2048617368204b6579"
+        "204669727374", data);
+    static const std::string expected =
+        "60e431591ee0b67f0d8a26aacbf5b77f"
+        "8e0bc6213728c5140546040f0ee37f54";
+
+    digest::HMAC_KEY<digest::SHA256> const hmac_key (key);
+    digest::HMAC<digest::SHA256> hmac1 (hmac_key);
+    digest::HMAC<digest::SHA256> hmac2 (hmac_key);
+    t.ok (hmac1.add (data).hexdigest () == expected
+        && hmac2.add (data).hexdigest () == expected,
+        "hmac-sha-256 shares HMAC_KEY");
+
+    digest::HMAC<digest::SHA256>::DIGEST got;
+    hmac1.add (data).digest ();
+    std::size_t const before = allocation_count;
+    digest::HMAC<digest::SHA256> hmac3 (hmac_key);
+    hmac3.add (data.data (), data.size ());
+    hmac3.digest_into (got.data ());
+    hmac1.add (data.data (), data.size ());
+    hmac1.digest_into (got.data ());
+    bool const no_allocation = allocation_count == before;
+    t.ok (no_allocation, "hmac-sha-256 without allocation");
+}
+
+void
+test_hmac_set_key (test::simple& t)
+{
+    // RFC 4231 test cases 1 and 2
+    std::string key1, data1;
+    mime::decode_hex ("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", key1);
+    mime::decode_hex ("4869205468657265", data1);
+    static const std::string expected1 =
+        "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7";
+    static const std::string key2 = "Jefe";
+    static const std::string data2 = "what do ya want for nothing?";
+    static const std::string expected2 =
+        "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843";
+
+    digest::HMAC<digest::SHA256> hmac (key1);
+    hmac.add (data1).digest ();
+    hmac.add ("partial message");
+    t.ok (hmac.set_key (key2).add (data2).hexdigest () == expected2,
+        "hmac-sha-256 set_key");
+    t.ok (hmac.set_key (digest::HMAC_KEY<digest::SHA256> (key1)).add (data1).hexdigest ()
+        == expected1, "hmac-sha-256 set_key HMAC_KEY");
+
+    digest::HMAC_POOL<digest::SHA256> pool (2);
+    digest::HMAC<digest::SHA256>& tenant1 = pool.acquire ("tenant1", key1);
+    tenant1.add (data1);
+    t.ok (pool.find ("tenant1") == &tenant1 && tenant1.add (data1).hexdigest () == expected1,
+        "hmac pool finds the context reset");
+    t.ok (pool.acquire ("tenant2", key2).add (data2).hexdigest () == expected2
+        && pool.acquire ("tenant1", key1).add (data1).hexdigest () == expected1,
+        "hmac pool acquire");
+    pool.acquire ("tenant3", key2);
+    t.ok (pool.size () == 2 && pool.find ("tenant2") == nullptr
+        && pool.find ("tenant1") != nullptr,
+        "hmac pool evicts the least recently used");
+    t.ok (pool.acquire ("tenant3", key2).add (data2).hexdigest () == expected2
+        && digest::HMAC_POOL<digest::SHA256>::local ().acquire ("tenant1", key1)
+            .add (data1).hexdigest () == expected1,
+        "hmac pool rekeys evicted storage");
+}
+
+void
+test_clone (test::simple& t)
+{
+    std::string const prefix (1000, 'h');
+    static const std::string tail1 = "GET /index.html";
+    static const std::string tail2 = "POST /form";
+
+    digest::SHA256 sha256;
+    digest::base& head = sha256.add (prefix);
+    std::unique_ptr<digest::base> fork1 = head.clone ();
+    std::unique_ptr<digest::base> fork2 = head.clone ();
+    t.ok (fork1->add (tail1).digest () == digest::SHA256 ().add (prefix + tail1).digest ()
+        && fork2->add (tail2).digest () == digest::SHA256 ().add (prefix + tail2).digest (),
+        "sha256 clone forks the prefix");
+    t.ok (sha256.add (tail2).digest () == digest::SHA256 ().add (prefix + tail2).digest (),
+        "sha256 clone keeps the original");
+
+    digest::HMAC<digest::SHA512> hmac ("key");
+    hmac.add (prefix);
+    std::unique_ptr<digest::base> hfork = hmac.clone ();
+    hmac.add (tail1);
+    hfork->add (tail2);
+    t.ok (hmac.digest () == digest::HMAC<digest::SHA512> ("key").add (prefix + tail1).digest ()
+        && hfork->digest () == digest::HMAC<digest::SHA512> ("key").add (prefix + tail2).digest (),
+        "hmac-sha512 clone forks the prefix");
+}
+
+// a PRF that pbkdf2 drives through the generic add and digest_into.
+struct generic_hmac_sha1 : public digest::HMAC<digest::SHA1> {
+    generic_hmac_sha1 (std::string const& key) : digest::HMAC<digest::SHA1> (key) {}
+};
+
+void
+test_pbkdf2_sha1 (test::simple& t)
+{
+    // RFC 6070 PKCS #5: Password-Based Key Derivation Function 2 (PBKDF2) Test Vectors
+    t.ok (mime::encode_hex (pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> (
+        "password", "salt", 1, 20)) == "0c60c80f961f0e71f3a9b524af6012062fe037a6",
+        "pbkdf2-sha1 rfc 6070 c=1");
+    t.ok (mime::encode_hex (pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> (
+        "password", "salt", 4096, 20)) == "4b007901b765489abead49d926f721d065a429c1",
+        "pbkdf2-sha1 rfc 6070 c=4096");
+    t.ok (mime::encode_hex (pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> (
+        "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25))
+        == "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038",
+        "pbkdf2-sha1 rfc 6070 dkLen=25");
+    t.ok (pkcs5::pbkdf2<generic_hmac_sha1> ("password", "salt", 4096, 25)
+        == pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> ("password", "salt", 4096, 25),
+        "pbkdf2 generic PRF");
+}
+
+void
+test_pbkdf2_parallel (test::simple& t)
+{
+    // a 160 octets key bundle of five HMAC-SHA256 blocks
+    std::string const expected =
+        "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a"
+        "f7ad98c1b458ce3fd74ca35beba3cda7b8d1038d6a87071b918f837405f3fe77"
+        "28ffe7f0976fc35dd82fc0e5e46ce9ce26a788b2c7d183fa5bf8d9607eecd71d"
+        "01b4f119af11b5782a2eb4df0fdecea0923c0012a97173ce79469bd09ce2d89f"
+        "6360217996756e8fb42c3354a6c5841f82c79848208acecbfe0ed482d25558d9";
+    t.ok (mime::encode_hex (pkcs5::pbkdf2_parallel<digest::HMAC<digest::SHA256>> (
+        "password", "salt", 4096, 160)) == expected,
+        "pbkdf2_parallel-sha256 160 octets");
+    t.ok (mime::encode_hex (pkcs5::pbkdf2_parallel<digest::HMAC<digest::SHA256>> (
+        "password", "salt", 4096, 160, 2)) == expected,
+        "pbkdf2_parallel-sha256 160 octets on 2 threads");
+    t.ok (pkcs5::pbkdf2_parallel<digest::HMAC<digest::SHA1>> ("password", "salt", 1000, 97, 8)
+        == pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> ("password", "salt", 1000, 97),
+        "pbkdf2_parallel-sha1 97 octets on 8 threads");
+    t.ok (pkcs5::pbkdf2_parallel<generic_hmac_sha1> ("password", "salt", 1000, 97, 3)
+        == pkcs5::pbkdf2<digest::HMAC<digest::SHA1>> ("password", "salt", 1000, 97),
+        "pbkdf2_parallel generic PRF");
+}
+
+void
+test_pbkdf2_multi (test::simple& t, std::string const& name)
+{
+    // more jobs than lanes, with salts across the padding boundary,
+    // passwords longer than a block and keys of partial blocks.
+    std::vector<pkcs5::pbkdf2_job> jobs;
+    jobs.push_back (pkcs5::pbkdf2_job {"password", "salt", 4096, 32});
+    for (std::size_t k = 0; k < 19; ++k) {
+        std::string const password (k * 7 % 90, static_cast<char> ('a' + k));
+        std::string const salt (k * 11 % 70 + (k == 3 ? 51 : 0), static_cast<char> ('A' + k));
+        jobs.push_back (pkcs5::pbkdf2_job {password, salt, 1 + k * 37 % 300, k * 13 % 101});
+    }
+    std::vector<std::string> const keys = pkcs5::pbkdf2_hmac_sha256_multi (jobs);
+    t.ok (keys.size () == jobs.size () && mime::encode_hex (keys[0])
+        == "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a",
+        "pbkdf2_hmac_sha256_multi " + name);
+    bool same = keys.size () == jobs.size ();
+    for (std::size_t k = 0; same && k < jobs.size (); ++k)
+        same = keys[k] == pkcs5::pbkdf2<digest::HMAC<digest::SHA256>> (
+            jobs[k].password, jobs[k].salt, jobs[k].rounds, jobs[k].keylen);
+    t.ok (same, "pbkdf2_hmac_sha256_multi same as pbkdf2 " + name);
+    t.ok (pkcs5::pbkdf2_hmac_sha256_multi (std::vector<pkcs5::pbkdf2_job> ()).empty (),
+        "pbkdf2_hmac_sha256_multi no jobs " + name);
+}
+
+void
+test_pbkdf2_calibrate (test::simple& t)
+{
+    std::chrono::duration<double> const target = std::chrono::milliseconds (20);
+    pkcs5::pbkdf2_calibration const c
+        = pkcs5::pbkdf2_calibrate<digest::HMAC<digest::SHA256>> (target, 7, 200);
+    t.ok (c.median.count () > 0.0 && c.p99 >= c.median,
+        "pbkdf2_calibrate statistics");
+    t.ok (c.rounds >= 1 && c.median * static_cast<double> (c.rounds) >= target
+        && c.median * static_cast<double> (c.rounds - 1) < target,
+        "pbkdf2_calibrate rounds for the target");
+}
+
+static std::string
+hex_octets (std::string const& hex)
+{
+    std::string octets;
+    mime::decode_hex (hex, octets);
+    return octets;
+}
+
+void
+test_hkdf (test::simple& t)
+{
+    // RFC 5869 Appendix A. Test Vectors
+    std::string const ikm1 (22, 0x0b);
+    std::string const salt1 = hex_octets ("000102030405060708090a0b0c");
+    std::string const info1 = hex_octets ("f0f1f2f3f4f5f6f7f8f9");
+    digest::SHA256::DIGEST const prk1 = rfc5869::hkdf_extract<digest::SHA256> (salt1, ikm1);
+    t.ok (mime::encode_hex (std::string (prk1.begin (), prk1.end ()))
+        == "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+        "hkdf-sha256 rfc 5869 A.1 PRK");
+    t.ok (mime::encode_hex (rfc5869::hkdf<digest::SHA256> (salt1, ikm1, info1, 42))
+        == "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c"
+           "5db02d56ecc4c5bf34007208d5b887185865",
+        "hkdf-sha256 rfc 5869 A.1 OKM");
+    std::string ikm2, salt2, info2;
+    for (int i = 0; i < 0x50; ++i) {
+        ikm2.push_back (static_cast<char> (i));
+        salt2.push_back (static_cast<char> (0x60 + i));
+        info2.push_back (static_cast<char> (0xb0 + i));
+    }
+    t.ok (mime::encode_hex (rfc5869::hkdf<digest::SHA256> (salt2, ikm2, info2, 82))
+        == "b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+           "59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+           "cc30c58179ec3e87c14c01d5c1f3434f1d87",
+        "hkdf-sha256 rfc 5869 A.2 OKM");
+    t.ok (mime::encode_hex (rfc5869::hkdf<digest::SHA256> (std::string (), ikm1, std::string (), 42))
+        == "8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d"
+           "9d201395faa4b61a96c8",
+        "hkdf-sha256 rfc 5869 A.3 OKM");
+
+    // subkeys of one PRK for several labels, written without allocation
+    std::string const salt ("salt");
+    std::string const secret ("secret");
+    digest::SHA256::DIGEST const prk = rfc5869::hkdf_extract<digest::SHA256> (salt, secret);
+    rfc5869::hkdf_expander<digest::SHA256> const expander (prk);
+    std::vector<octets::view> const labels {
+        octets::view ("enc", 3), octets::view ("mac", 3), octets::view ("iv", 2)};
+    std::uint8_t okm[3 * 40];
+    std::size_t const before = allocation_count;
+    expander.expand (labels, okm, 40);
+    bool const no_allocation = allocation_count == before;
+    t.ok (mime::encode_hex (std::string (okm, okm + sizeof okm))
+        == "e24834ff15b91283c686dd38f43e87a36219cafa04bf4d55eb56ce4229e15593be696a4f4b4698f9"
+           "91e4fab660fcd4fc85404d69e41983c4ba43ce8cc098c54965a5fd3d77c9ee96c2b5c7ef164e5a63"
+           "c53c997e7ed10d08e92e6569a095f6851eb49705eebfcb6f2285e0cc0d863ace40cbea963a670156",
+        "hkdf-sha256 expand labels");
+    t.ok (no_allocation, "hkdf-sha256 expand without allocation");
+
+    std::string const x ("x");
+    std::string const longest = rfc5869::hkdf<digest::SHA512> (salt, secret, x, 255 * 64);
+    t.ok (mime::encode_hex (longest.substr (longest.size () - 16))
+        == "ab190f36fefad91170444b56a4b96081",
+        "hkdf-sha512 255 blocks");
+    bool thrown = false;
+    try {
+        rfc5869::hkdf<digest::SHA512> (salt, secret, x, 255 * 64 + 1);
+    }
+    catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    t.ok (thrown, "hkdf-sha512 too long");
+}
+
+// runs the vectors depending on SHA-1 and SHA-256 with the given engine
+void
+test_sha2_32bit_engine (test::simple& t,
+    digest::SHA2_32BIT::engine_type const engine, std::string const& name)
+{
+    if (! digest::SHA2_32BIT::select_engine (engine)) {
+        t.diag (name + " engine is not available, testing the portable one.");
+        digest::SHA2_32BIT::select_engine (digest::SHA2_32BIT::ENGINE_PORTABLE);
+    }
     test_sha256 (t);
     test_sha256_more (t);
-    test_sha512 (t);
     test_sha224 (t);
-    test_sha384 (t);
-    test_sha512_224 (t);
-    test_sha512_256 (t);
     test_sha1 (t);
+    test_sha_padding (t);
+    test_sha256_multi (t);
     test_hmac_1 (t);
     test_hmac_2 (t);
     test_hmac_3 (t);
@@ -961,6 +1472,33 @@ main ()
     test_hmac_6 (t);
     test_hmac_7 (t);
     test_rfc6238_totp (t);
+    test_pbkdf2_sha256 (t);
+    test_pbkdf2_sha1 (t);
+    test_pbkdf2_multi (t, name);
+    digest::SHA2_32BIT::select_engine (digest::SHA2_32BIT::ENGINE_AUTO);
+}
+
+int
+main ()
+{
+    test::simple t (298);
+    test_sha2_32bit_engine (t, digest::SHA2_32BIT::ENGINE_PORTABLE, "portable");
+    test_sha2_32bit_engine (t, digest::SHA2_32BIT::ENGINE_SHANI, "sha-ni");
+    test_sha512 (t);
+    test_sha384 (t);
+    test_sha512_224 (t);
+    test_sha512_256 (t);
+    test_sha512_padding (t);
+    test_sha512_multi (t);
+    test_octets_view (t);
+    test_digest_into (t);
+    test_export_state (t);
+    test_clone (t);
+    test_hmac_key (t);
+    test_hmac_set_key (t);
+    test_pbkdf2_parallel (t);
+    test_pbkdf2_calibrate (t);
+    test_hkdf (t);
     test_encode_base64_foobar (t);
     test_decode_base64_foobar (t);
     test_encode_base32_foobar (t);
@@ -970,6 +1508,5 @@ main ()
     test_encode_base16 (t);
     test_decode_base16 (t);
     test_base64_more (t);
-    test_pbkdf2_sha256 (t);
     return t.done_testing ();
 }
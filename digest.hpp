@@ -1,40 +1,86 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
 #include <cstdint>
+#include "octets-view.hpp"
 
 namespace digest {
 
 class base {
+public:
+    enum { MAXBLOCKSIZE = 128, MAXDIGESTSIZE = 64 };
 protected:
     enum { INIT, ADD, FINISH } mstate;
-    std::string mbuf;
+    // the partial block, or the last full block when keeps_last_block.
+    std::uint8_t mbuf[MAXBLOCKSIZE];
+    std::size_t mbuflen;
     std::size_t mlen;
 public:
-    base () : mstate (INIT), mbuf (), mlen (0) {}
+    base () : mstate (INIT), mbuf (), mbuflen (0), mlen (0) {}
     virtual ~base () {}
     virtual base& reset ();
-    virtual base& add (std::string::const_iterator s, std::string::const_iterator e);
-    virtual base& add (std::string const& data);
+    virtual base& add (void const* data, std::size_t size);
+    base& add (octets::view const& data);
+    base& add (std::string::const_iterator s, std::string::const_iterator e);
+    base& add (std::string const& data);
     virtual base& finish ();
-    virtual std::string digest () = 0;
+    // duplicates the object with its running state, so that a common
+    // prefix hashed once can be continued with different tails.
+    virtual std::unique_ptr<base> clone () const = 0;
+    virtual std::string digest ();
     virtual std::string hexdigest ();
+    // writes digestsize () octets to out without heap allocation.
+    virtual void digest_into (std::uint8_t* out) = 0;
+    virtual std::size_t digestsize () const = 0;
     virtual std::size_t blocksize () const = 0;
+    // versioned binary snapshot of the running state to resume hashing
+    // in another object or process. keys and associated data are not in
+    // it, so set them the same way before import_state. import_state
+    // returns false and keeps the object as is on a foreign state.
+    virtual std::string export_state () const;
+    virtual bool import_state (octets::view const& state);
 protected:
+    enum { STATE_VERSION = 1 };
+    enum {
+        STATE_SHA1 = 1, STATE_SHA224, STATE_SHA256, STATE_SHA384,
+        STATE_SHA512, STATE_SHA512_224, STATE_SHA512_256,
+        STATE_GHASH, STATE_POLY1305, STATE_AES_CMAC,
+        STATE_HMAC = 0x80
+    };
     virtual void init_sum () = 0;
-    virtual void update_sum (std::string::const_iterator s) = 0;
+    // compresses nblocks consecutive blocks of blocksize () octets.
+    virtual void update_blocks (std::uint8_t const* p, std::size_t nblocks) = 0;
     virtual void last_sum () = 0;
+    virtual bool keeps_last_block () const { return false; }
+    virtual std::uint8_t state_tag () const = 0;
+    // appends the running sum, or reads it back from exactly n octets.
+    virtual void export_sum (std::string& out) const = 0;
+    virtual bool import_sum (std::uint8_t const* p, std::size_t n) = 0;
+    static void pack_state (std::string& out, std::uint64_t const x, std::size_t const n);
+    static std::uint64_t unpack_state (std::uint8_t const* p, std::size_t const n);
 };
 
 class SHA2_32BIT : public base {
 protected:
     std::uint32_t sum[8];
 public:
+    // compression engines shared by SHA-1, SHA-224 and SHA-256.
+    // ENGINE_AUTO picks SHA extensions when the cpu has them.
+    enum engine_type { ENGINE_AUTO, ENGINE_PORTABLE, ENGINE_SHANI };
+    static bool select_engine (engine_type const e);
+    static engine_type engine ();
+
     SHA2_32BIT () : base (), sum () {}
     std::size_t blocksize () const { return 64U; }
 protected:
-    void update_sum (std::string::const_iterator s);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
     void last_sum ();
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 };
 
 class SHA2_64BIT : public base {
@@ -44,109 +90,229 @@ public:
     SHA2_64BIT () : base (), sum () {}
     std::size_t blocksize () const { return 128U; }
 protected:
-    void update_sum (std::string::const_iterator s);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
     void last_sum ();
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 };
 
 class SHA1 : public SHA2_32BIT {
 protected:
     std::uint32_t sum[5];
 public:
+    enum { DIGESTSIZE = 20 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA1 () : SHA2_32BIT () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA1 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
-    void update_sum (std::string::const_iterator s);
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks);
+    std::uint8_t state_tag () const { return STATE_SHA1; }
+    void export_sum (std::string& out) const;
+    bool import_sum (std::uint8_t const* p, std::size_t n);
 };
 
 class SHA224 : public SHA2_32BIT {
 public:
+    enum { DIGESTSIZE = 28 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA224 () : SHA2_32BIT () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA224 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
+    std::uint8_t state_tag () const { return STATE_SHA224; }
 };
 
 class SHA256 : public SHA2_32BIT {
 public:
+    enum { DIGESTSIZE = 32 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA256 () : SHA2_32BIT () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA256 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
+    // the chaining words, which are a midstate after whole blocks,
+    // say the inner or outer state of an HMAC_KEY<SHA256>.
+    void midstate (std::uint32_t h[8]) const { std::copy (sum, sum + 8, h); }
 protected:
     void init_sum ();
+    std::uint8_t state_tag () const { return STATE_SHA256; }
 };
 
+// multi-buffer SHA-256 and SHA-224 hashing independent messages at once.
+// each result is the same as SHA256 ().add (message).digest ().
+std::vector<std::string> sha256_multi (std::vector<std::string> const& messages);
+std::vector<std::string> sha224_multi (std::vector<std::string> const& messages);
+
+// eight independent SHA-256 compressions in AVX2 lanes, or lane by lane
+// when the SHA extensions engine is selected, since it is faster still.
+// state[i][lane] is the i-th chaining word of the lane,
+// and block[lane] points 64 octets of the lane's message.
+void sha256_compress_x8 (std::uint32_t state[8][8], std::uint8_t const* const block[8]);
+
 class SHA384 : public SHA2_64BIT {
 public:
+    enum { DIGESTSIZE = 48 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA384 () : SHA2_64BIT () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA384 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
+    std::uint8_t state_tag () const { return STATE_SHA384; }
 };
 
 class SHA512 : public SHA2_64BIT {
 public:
+    enum { DIGESTSIZE = 64 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA512 () : SHA2_64BIT () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA512 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
 protected:
     void init_sum ();
+    std::uint8_t state_tag () const { return STATE_SHA512; }
 };
 
 class SHA512_224 : public SHA512 {
 public:
+    enum { DIGESTSIZE = 28 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA512_224 () : SHA512 () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA512_224 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
+protected:
+    std::uint8_t state_tag () const { return STATE_SHA512_224; }
 };
 
 class SHA512_256 : public SHA512 {
 public:
+    enum { DIGESTSIZE = 32 };
+    using DIGEST = std::array<std::uint8_t,DIGESTSIZE>;
     SHA512_256 () : SHA512 () {}
-    std::string digest ();
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new SHA512_256 (*this)); }
+    void digest_into (std::uint8_t* out);
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
+protected:
+    std::uint8_t state_tag () const { return STATE_SHA512_256; }
+};
+
+// multi-buffer SHA-512 family hashing independent messages at once.
+// each result is the same as the digest of the corresponding class.
+std::vector<std::string> sha512_multi (std::vector<std::string> const& messages);
+std::vector<std::string> sha384_multi (std::vector<std::string> const& messages);
+std::vector<std::string> sha512_224_multi (std::vector<std::string> const& messages);
+std::vector<std::string> sha512_256_multi (std::vector<std::string> const& messages);
+
+// four independent SHA-512 compressions in AVX2 lanes.
+// state[i][lane] is the i-th chaining word of the lane,
+// and block[lane] points 128 octets of the lane's message.
+void sha512_compress_x4 (std::uint64_t state[8][4], std::uint8_t const* const block[4]);
+
+// immutable HMAC key holding the hash states after the key xor ipad
+// and the key xor opad blocks. it is computed once per key and may be
+// shared read-only between threads, each HMAC copying the states.
+template<class HASH>
+class HMAC_KEY {
+    HASH mipad;
+    HASH mopad;
+public:
+    explicit HMAC_KEY (octets::view const& key) : mipad (), mopad ()
+    {
+        derive (key, mipad, mopad);
+    }
+
+    HASH const& inner () const { return mipad; }
+    HASH const& outer () const { return mopad; }
+
+    static void
+    derive (octets::view const& key, HASH& ipad, HASH& opad)
+    {
+        std::size_t const blksize = ipad.blocksize ();
+        std::uint8_t pad[base::MAXBLOCKSIZE] = {0};
+        if (key.size () > blksize)
+            HASH ().add (key).digest_into (pad);
+        else
+            std::copy (key.begin (), key.end (), pad);
+        for (std::size_t i = 0; i < blksize; ++i)
+            pad[i] ^= 0x36;
+        ipad.reset ().add (pad, blksize);
+        for (std::size_t i = 0; i < blksize; ++i)
+            pad[i] ^= 0x36 ^ 0x5c;
+        opad.reset ().add (pad, blksize);
+        std::fill (pad, pad + blksize, 0);
+    }
 };
 
 template<class HASH>
 class HMAC : public base {
+    HASH ikey;
+    HASH okey;
     HASH ihash;
     HASH ohash;
-    std::string mkey;
 public:
-    HMAC (std::string const& key) : base (), ihash (), ohash (), mkey (key) {}
-    std::string digest () { finish (); return ohash.digest (); }
-    std::string hexdigest () { finish (); return ohash.hexdigest (); }
+    enum { DIGESTSIZE = HASH::DIGESTSIZE };
+    using DIGEST = typename HASH::DIGEST;
+    HMAC (std::string const& key) : HMAC (HMAC_KEY<HASH> (key)) {}
+    HMAC (HMAC_KEY<HASH> const& key)
+        : base (), ikey (key.inner ()), okey (key.outer ()), ihash (), ohash () {}
+
+    // rekeys in place and discards the message so far.
+    HMAC&
+    set_key (octets::view const& key)
+    {
+        HMAC_KEY<HASH>::derive (key, ikey, okey);
+        mstate = INIT;
+        return *this;
+    }
+
+    HMAC&
+    set_key (HMAC_KEY<HASH> const& key)
+    {
+        ikey = key.inner ();
+        okey = key.outer ();
+        mstate = INIT;
+        return *this;
+    }
+    std::unique_ptr<base> clone () const { return std::unique_ptr<base> (new HMAC (*this)); }
+    void digest_into (std::uint8_t* out) { finish (); ohash.digest_into (out); }
+    std::size_t digestsize () const { return DIGESTSIZE; }
+    DIGEST digest_array () { DIGEST d; digest_into (d.data ()); return d; }
     std::size_t blocksize () const { return ihash.blocksize (); }
 
     base&
     reset ()
     {
-        std::size_t const blksize = blocksize ();
-        if (mkey.size () > blksize) {
-            HASH khash;
-            mkey = khash.add(mkey).digest ();
-        }
-        if (mkey.size () < blksize)
-            mkey.resize (blksize, 0);
-        std::string kipad (mkey);
-        for (std::size_t i = 0; i < blksize; ++i)
-            kipad[i] ^= 0x36;
-        ihash.reset ().add (kipad);
+        ihash = ikey;
         mstate = ADD;
         return *this;
     }
 
+    using base::add;
+
     base&
-    add (std::string::const_iterator s, std::string::const_iterator e)
+    add (void const* data, std::size_t size)
     {
         if (ADD != mstate)
             reset ();
-        ihash.add (s, e);
+        ihash.add (data, size);
         return *this;
     }
 
-    base&
-    add (std::string const& data)
-    {
-        return add (data.cbegin (), data.cend ());
-    }
-
     base&
     finish (void)
     {
@@ -155,18 +321,54 @@ public:
         if (ADD != mstate)
             reset ();
         mstate = FINISH;
-        std::string kopad (mkey);
-        std::size_t const blksize = blocksize ();
-        for (std::size_t i = 0; i < blksize; ++i)
-            kopad[i] ^= 0x5c;
-        ohash.reset ().add (kopad).add (ihash.digest ());
+        std::uint8_t inner[DIGESTSIZE];
+        ihash.digest_into (inner);
+        ohash = okey;
+        ohash.add (inner, sizeof (inner));
         return *this;
     }
 
+    // the inner and the outer hash states, the key is not in it.
+    std::string
+    export_state () const
+    {
+        std::string const inner = ihash.export_state ();
+        std::string const outer = ohash.export_state ();
+        std::string state;
+        state.push_back (STATE_VERSION);
+        state.push_back (STATE_HMAC | inner[1]);
+        state.push_back (mstate);
+        pack_state (state, inner.size (), 2);
+        return state + inner + outer;
+    }
+
+    bool
+    import_state (octets::view const& state)
+    {
+        std::uint8_t const tag = STATE_HMAC | ihash.export_state ()[1];
+        if (state.size () < 5 || STATE_VERSION != state[0] || tag != state[1]
+                || state[2] > FINISH)
+            return false;
+        std::size_t const n = unpack_state (state.data () + 3, 2);
+        HASH inner;
+        HASH outer;
+        if (n > state.size () - 5
+                || ! inner.import_state (state.subview (5, n))
+                || ! outer.import_state (state.subview (5 + n)))
+            return false;
+        ihash = inner;
+        ohash = outer;
+        mstate = static_cast<decltype (mstate)> (state[2]);
+        return true;
+    }
+
 protected:
     void init_sum () {}
-    void update_sum (std::string::const_iterator s) {}
+    void update_blocks (std::uint8_t const* p, std::size_t nblocks) {}
     void last_sum () {}
+    std::uint8_t state_tag () const { return STATE_HMAC; }
+    void export_sum (std::string& out) const {}
+    bool import_sum (std::uint8_t const* p, std::size_t n) { return false; }
 };
 
 }//namespace digest
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <array>
+
+namespace octets {
+
+// non-owning view of contiguous octets for C++11.
+// it lets digests and ciphers read mmap'd regions, ring buffers and
+// std::vector<std::uint8_t> in place without copying into std::string.
+// the viewed storage must outlive the view.
+class view {
+public:
+    using const_iterator = std::uint8_t const*;
+
+    view () : mdata (nullptr), msize (0) {}
+    view (void const* data, std::size_t size)
+        : mdata (static_cast<std::uint8_t const*> (data)), msize (size) {}
+    view (std::string const& s)
+        : mdata (reinterpret_cast<std::uint8_t const*> (s.data ())), msize (s.size ()) {}
+    view (std::string::const_iterator s, std::string::const_iterator e)
+        : mdata (s < e ? reinterpret_cast<std::uint8_t const*> (&*s) : nullptr),
+          msize (s < e ? e - s : 0) {}
+    view (std::vector<std::uint8_t> const& v)
+        : mdata (v.data ()), msize (v.size ()) {}
+    template<std::size_t N>
+    view (std::array<std::uint8_t,N> const& a)
+        : mdata (a.data ()), msize (N) {}
+
+    std::uint8_t const* data () const { return mdata; }
+    std::size_t size () const { return msize; }
+    bool empty () const { return 0 == msize; }
+    const_iterator begin () const { return mdata; }
+    const_iterator end () const { return mdata + msize; }
+    std::uint8_t operator[] (std::size_t const i) const { return mdata[i]; }
+
+    view
+    subview (std::size_t const pos, std::size_t const n = std::string::npos) const
+    {
+        std::size_t const i = pos < msize ? pos : msize;
+        std::size_t const m = n < msize - i ? n : msize - i;
+        return view (mdata + i, m);
+    }
+
+    std::string str () const { return std::string (begin (), end ()); }
+
+private:
+    std::uint8_t const* mdata;
+    std::size_t msize;
+};
+
+}//namespace octets
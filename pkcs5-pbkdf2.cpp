@@ -0,0 +1,205 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "digest.hpp"
+#include "pkcs5-pbkdf2.hpp"
+
+// multi-buffer PBKDF2-HMAC-SHA256
+//
+// each output block T_i of each job is a task for one of the eight
+// lanes of digest::sha256_compress_x8. a lane first runs the inner
+// message salt || INT (i) from the ipad midstate of the password,
+// then alternates the outer and the inner compressions of U_j, both
+// of them a single block of U_{j-1} and its padding. when a lane has
+// xored its last U_j into T_i, it loads the next task, so jobs of
+// different rounds and lengths keep all eight lanes busy.
+
+namespace pkcs5 {
+
+enum { HLEN = 32, NLANE = 8 };
+
+static inline void
+pack_digest (std::uint8_t* p, std::uint32_t const state[8][8], int const lane)
+{
+    for (int i = 0; i < 8; ++i) {
+        std::uint32_t const x = state[i][lane];
+        p[i * 4 + 0] = (x >> 24) & 0xff;
+        p[i * 4 + 1] = (x >> 16) & 0xff;
+        p[i * 4 + 2] = (x >>  8) & 0xff;
+        p[i * 4 + 3] = x & 0xff;
+    }
+}
+
+static inline void
+pack_length (std::uint8_t* p, std::uint64_t const bitlen)
+{
+    for (int k = 0; k < 8; ++k)
+        p[7 - k] = (bitlen >> (k * 8)) & 0xff;
+}
+
+struct pbkdf2_lane {
+    enum phase_type { FIRST, OUTER, INNER };
+
+    std::size_t job;
+    std::size_t offset;
+    std::size_t rounds;
+    phase_type phase;
+    std::size_t block;
+    std::vector<std::uint8_t> first;
+    std::uint32_t ipad[8];
+    std::uint32_t opad[8];
+    std::uint8_t u[64];
+    std::uint8_t t[HLEN];
+
+    // T_i at offset of the job, from the midstates of its password.
+    void
+    load (pbkdf2_job const& x, std::size_t const j, std::size_t const off,
+        std::uint32_t const* ip, std::uint32_t const* op)
+    {
+        std::uint32_t const i = static_cast<std::uint32_t> (off / HLEN + 1);
+        std::size_t const m = x.salt.size () + 4U;
+        job = j;
+        offset = off;
+        rounds = std::max<std::size_t> (1, x.rounds);
+        phase = FIRST;
+        block = 0;
+        first.assign ((m + 1U + 8U + 63U) / 64U * 64U, 0);
+        std::copy (x.salt.begin (), x.salt.end (), first.begin ());
+        first[m - 4] = (i >> 24) & 0xff;
+        first[m - 3] = (i >> 16) & 0xff;
+        first[m - 2] = (i >>  8) & 0xff;
+        first[m - 1] = i & 0xff;
+        first[m] = 0x80;
+        pack_length (&first[first.size () - 8], (64U + m) * 8U);
+        std::copy (ip, ip + 8, ipad);
+        std::copy (op, op + 8, opad);
+        std::fill (u + HLEN, u + 64, 0);
+        u[HLEN] = 0x80;
+        pack_length (u + 56, (64U + HLEN) * 8U);
+        std::fill (t, t + HLEN, 0);
+    }
+
+    std::uint8_t const*
+    current () const
+    {
+        return FIRST == phase ? &first[block * 64U] : u;
+    }
+};
+
+std::vector<std::string>
+pbkdf2_hmac_sha256_multi (std::vector<pbkdf2_job> const& jobs)
+{
+    static std::uint8_t const idle[64] = {0};
+    std::vector<std::string> keys (jobs.size ());
+    for (std::size_t j = 0; j < jobs.size (); ++j)
+        keys[j].assign (jobs[j].keylen, 0);
+    std::uint32_t state[8][8];
+    pbkdf2_lane lane[NLANE];
+    bool busy[NLANE];
+    int nbusy = 0;
+    // the next task is the block at next_offset of the job next_job,
+    // and the midstates of its password are computed once per job.
+    std::size_t next_job = 0;
+    std::size_t next_offset = 0;
+    std::size_t key_job = jobs.size ();
+    std::uint32_t ipad[8];
+    std::uint32_t opad[8];
+    auto load = [&] (int const k) -> bool {
+        while (next_job < jobs.size () && next_offset >= jobs[next_job].keylen) {
+            ++next_job;
+            next_offset = 0;
+        }
+        if (next_job >= jobs.size ())
+            return false;
+        if (key_job != next_job) {
+            digest::HMAC_KEY<digest::SHA256> const key (jobs[next_job].password);
+            key.inner ().midstate (ipad);
+            key.outer ().midstate (opad);
+            key_job = next_job;
+        }
+        lane[k].load (jobs[next_job], next_job, next_offset, ipad, opad);
+        for (int i = 0; i < 8; ++i)
+            state[i][k] = ipad[i];
+        next_offset += HLEN;
+        return true;
+    };
+    for (int k = 0; k < NLANE; ++k) {
+        busy[k] = load (k);
+        if (busy[k])
+            ++nbusy;
+    }
+    while (nbusy > 0) {
+        std::uint8_t const *block[NLANE];
+        for (int k = 0; k < NLANE; ++k)
+            block[k] = busy[k] ? lane[k].current () : idle;
+        digest::sha256_compress_x8 (state, block);
+        for (int k = 0; k < NLANE; ++k) {
+            if (! busy[k])
+                continue;
+            pbkdf2_lane& x = lane[k];
+            std::uint32_t const* next_state = x.opad;
+            if (pbkdf2_lane::FIRST == x.phase) {
+                if (++x.block < x.first.size () / 64U)
+                    continue;
+                pack_digest (x.u, state, k);
+                x.phase = pbkdf2_lane::OUTER;
+            }
+            else if (pbkdf2_lane::INNER == x.phase) {
+                pack_digest (x.u, state, k);
+                x.phase = pbkdf2_lane::OUTER;
+            }
+            else {
+                pack_digest (x.u, state, k);
+                for (int i = 0; i < HLEN; ++i)
+                    x.t[i] ^= x.u[i];
+                if (--x.rounds > 0) {
+                    next_state = x.ipad;
+                    x.phase = pbkdf2_lane::INNER;
+                }
+                else {
+                    std::string& key = keys[x.job];
+                    std::size_t const n = std::min<std::size_t> (HLEN, key.size () - x.offset);
+                    std::copy (x.t, x.t + n, key.begin () + x.offset);
+                    busy[k] = load (k);
+                    if (! busy[k])
+                        --nbusy;
+                    continue;
+                }
+            }
+            for (int i = 0; i < 8; ++i)
+                state[i][k] = next_state[i];
+        }
+    }
+    return keys;
+}
+
+}//namespace pkcs5
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
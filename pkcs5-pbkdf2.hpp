@@ -1,39 +1,204 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <system_error>
+#include <chrono>
+#include <cmath>
+#include "digest.hpp"
 
 namespace pkcs5 {
 
+// computes T_i blocks of PBKDF2 for a password.
+// any PRF constructible from the password works through add and digest_into.
+template<class PRF>
+class pbkdf2_engine {
+public:
+    enum { HLEN = PRF::DIGESTSIZE };
+
+    explicit pbkdf2_engine (std::string const& password) : prf (password) {}
+
+    // T_i = U_1 ^ U_2 ^ ... ^ U_rounds into t[0 .. HLEN)
+    void
+    block (std::string const& salt, std::size_t const rounds, std::uint32_t const i,
+        std::uint8_t* t)
+    {
+        std::uint8_t u[HLEN];
+        std::uint8_t const count[4] = {
+            static_cast<std::uint8_t> (i >> 24), static_cast<std::uint8_t> (i >> 16),
+            static_cast<std::uint8_t> (i >> 8), static_cast<std::uint8_t> (i)};
+        prf.add (salt).add (count, 4).digest_into (u);
+        std::copy (u, u + HLEN, t);
+        for (std::size_t j = 1; j < rounds; ++j) {
+            prf.add (u, HLEN).digest_into (u);
+            for (std::size_t k = 0; k < HLEN; ++k)
+                t[k] ^= u[k];
+        }
+    }
+
+private:
+    PRF prf;
+};
+
+// HMAC starts each U_j from the ipad and opad states hashed once per
+// password, so an iteration is one inner and one outer compression
+// on fixed arrays.
+template<class HASH>
+class pbkdf2_engine<digest::HMAC<HASH>> {
+public:
+    enum { HLEN = HASH::DIGESTSIZE };
+
+    explicit pbkdf2_engine (std::string const& password) : key (password) {}
+
+    void
+    block (std::string const& salt, std::size_t const rounds, std::uint32_t const i,
+        std::uint8_t* t) const
+    {
+        std::uint8_t u[HLEN];
+        std::uint8_t const count[4] = {
+            static_cast<std::uint8_t> (i >> 24), static_cast<std::uint8_t> (i >> 16),
+            static_cast<std::uint8_t> (i >> 8), static_cast<std::uint8_t> (i)};
+        HASH ihash (key.inner ());
+        HASH ohash (key.outer ());
+        ihash.add (salt);
+        ihash.add (count, 4);
+        ihash.digest_into (u);
+        ohash.add (u, HLEN);
+        ohash.digest_into (u);
+        std::copy (u, u + HLEN, t);
+        for (std::size_t j = 1; j < rounds; ++j) {
+            ihash = key.inner ();
+            ihash.add (u, HLEN);
+            ihash.digest_into (u);
+            ohash = key.outer ();
+            ohash.add (u, HLEN);
+            ohash.digest_into (u);
+            for (std::size_t k = 0; k < HLEN; ++k)
+                t[k] ^= u[k];
+        }
+    }
+
+private:
+    digest::HMAC_KEY<HASH> key;
+};
+
 // Password-Based Key Derivation Function 2 (PBKDF2)
 // see RFC 2898 PKCS#5 version 2.0
 template<class PRF>
 std::string
 pbkdf2 (std::string const& password, std::string const& salt, std::size_t const rounds, std::size_t keylen)
 {
-    PRF prf (password);
+    enum { HLEN = pbkdf2_engine<PRF>::HLEN };
+    pbkdf2_engine<PRF> engine (password);
     std::string key;
+    std::uint8_t t[HLEN];
     std::uint32_t i = 0;
     while (keylen > 0) {
-        ++i;
-        std::string block_number;
-        block_number.push_back ((i >> 24) & 0xff);
-        block_number.push_back ((i >> 16) & 0xff);
-        block_number.push_back ((i >>  8) & 0xff);
-        block_number.push_back (i & 0xff);
-        std::string u = prf.add (salt).add (block_number).digest ();
-        std::string t = u;
-        for (std::size_t j = 1; j < rounds; ++j) {
-            u = prf.add (u).digest ();
-            for (std::size_t k = 0; k < u.size (); ++k)
-                t[k] ^= u[k];
-        }
-        std::size_t n = std::min (keylen, t.size ());
-        key.append (t.begin (), t.begin () + n);
+        engine.block (salt, rounds, ++i, t);
+        std::size_t n = std::min<std::size_t> (keylen, HLEN);
+        key.append (t, t + n);
         keylen -= n;
     }
     return key;
 }
 
+// the same derived key as pbkdf2, computing the T_i blocks on
+// up to nthread threads at once. nthread 0 means one per block up to
+// std::thread::hardware_concurrency. the calling thread joins the
+// work, so it ends up serial when no thread can be started.
+template<class PRF>
+std::string
+pbkdf2_parallel (std::string const& password, std::string const& salt, std::size_t const rounds, std::size_t const keylen,
+    std::size_t nthread = 0)
+{
+    enum { HLEN = pbkdf2_engine<PRF>::HLEN };
+    std::size_t const nblock = (keylen + HLEN - 1) / HLEN;
+    if (0 == nthread)
+        nthread = std::max<std::size_t> (1, std::thread::hardware_concurrency ());
+    nthread = std::min (nthread, nblock);
+    if (nthread <= 1)
+        return pbkdf2<PRF> (password, salt, rounds, keylen);
+    pbkdf2_engine<PRF> const engine (password);
+    std::vector<std::uint8_t> t (nblock * HLEN);
+    std::atomic<std::size_t> next (0);
+    auto work = [&] () {
+        pbkdf2_engine<PRF> local (engine);
+        for (std::size_t i; (i = next++) < nblock; )
+            local.block (salt, rounds, static_cast<std::uint32_t> (i + 1), &t[i * HLEN]);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve (nthread - 1);
+    try {
+        while (workers.size () < nthread - 1)
+            workers.emplace_back (work);
+    }
+    catch (std::system_error const&) {
+        // leave the rest of the blocks to the started threads and to us
+    }
+    work ();
+    for (std::thread& worker : workers)
+        worker.join ();
+    return std::string (t.begin (), t.begin () + keylen);
+}
+
+// measured cost of a PRF iteration on the running machine.
+struct pbkdf2_calibration {
+    std::size_t rounds;                     // for the target time of a block
+    std::chrono::duration<double> median;   // per iteration
+    std::chrono::duration<double> p99;      // per iteration
+};
+
+// times nsample runs of sample_rounds iterations of the PRF with the
+// engine selected now, and returns the rounds that make a derived key
+// block cost target at the median rate. a key of several blocks costs
+// that many times more with pbkdf2, and the same with pbkdf2_parallel.
+template<class PRF>
+pbkdf2_calibration
+pbkdf2_calibrate (std::chrono::duration<double> const target,
+    std::size_t const nsample = 31, std::size_t const sample_rounds = 1000)
+{
+    typedef std::chrono::steady_clock clock;
+    enum { HLEN = pbkdf2_engine<PRF>::HLEN };
+    pbkdf2_engine<PRF> engine ("calibration password");
+    std::string const salt ("calibration salt");
+    std::size_t const n = std::max<std::size_t> (1, nsample);
+    std::size_t const m = std::max<std::size_t> (1, sample_rounds);
+    std::vector<std::chrono::duration<double>> sample (n);
+    std::uint8_t t[HLEN];
+    // the first run warms up caches and lets the clock settle
+    engine.block (salt, m, 1, t);
+    for (std::size_t k = 0; k < n; ++k) {
+        clock::time_point const start = clock::now ();
+        engine.block (salt, m, 1, t);
+        sample[k] = (clock::now () - start) / static_cast<double> (m);
+    }
+    std::sort (sample.begin (), sample.end ());
+    pbkdf2_calibration c;
+    c.median = sample[n / 2];
+    c.p99 = sample[std::min (n - 1, static_cast<std::size_t> (std::ceil (n * 0.99)) - 1)];
+    double const rounds = c.median.count () > 0.0
+        ? std::ceil (target.count () / c.median.count ()) : 1.0;
+    c.rounds = std::max<std::size_t> (1, static_cast<std::size_t> (rounds));
+    return c;
+}
+
+// a password of a pbkdf2_hmac_sha256_multi batch.
+struct pbkdf2_job {
+    std::string password;
+    std::string salt;
+    std::size_t rounds;
+    std::size_t keylen;
+};
+
+// PBKDF2-HMAC-SHA256 of many passwords at once in the lanes of
+// digest::sha256_compress_x8, see pkcs5-pbkdf2.cpp. each key is the same
+// as pbkdf2<digest::HMAC<digest::SHA256>> (password, salt, rounds, keylen).
+std::vector<std::string> pbkdf2_hmac_sha256_multi (std::vector<pbkdf2_job> const& jobs);
+
 }//namespace pkcs5
 
 /* Copyright (c) 2016, MIZUTANI Tociyuki  
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "octets-view.hpp"
+#include "digest.hpp"
+
+namespace rfc5869 {
+
+// HMAC-based Extract-and-Expand Key Derivation Function (HKDF)
+// see RFC 5869
+
+// PRK = HMAC-Hash (salt, IKM). an empty salt is HashLen zero octets,
+// which HMAC pads to the same key block.
+template<class HASH>
+typename HASH::DIGEST
+hkdf_extract (octets::view const& salt, octets::view const& ikm)
+{
+    digest::HMAC_KEY<HASH> const key (salt);
+    HASH ihash (key.inner ());
+    HASH ohash (key.outer ());
+    typename HASH::DIGEST prk;
+    ihash.add (ikm);
+    ihash.digest_into (prk.data ());
+    ohash.add (prk.data (), prk.size ());
+    ohash.digest_into (prk.data ());
+    return prk;
+}
+
+// expands a PRK to OKM for any number of info labels. the ipad and opad
+// states of the PRK are hashed once, and each T(i) block is made from
+// copies of them into fixed arrays and the caller's buffer.
+template<class HASH>
+class hkdf_expander {
+public:
+    enum { HASHLEN = HASH::DIGESTSIZE, MAXLENGTH = 255 * HASHLEN };
+
+    explicit hkdf_expander (octets::view const& prk) : key (prk) {}
+
+    // OKM of length octets into okm.
+    void
+    expand (octets::view const& info, std::uint8_t* okm, std::size_t const length) const
+    {
+        if (length > MAXLENGTH)
+            throw std::runtime_error ("hkdf length must be at most 255 * HashLen.");
+        std::uint8_t t[HASHLEN];
+        std::uint8_t u[HASHLEN];
+        std::size_t pos = 0;
+        for (std::uint8_t i = 1; pos < length; ++i) {
+            HASH ihash (key.inner ());
+            if (i > 1)
+                ihash.add (t, HASHLEN);
+            ihash.add (info);
+            ihash.add (&i, 1);
+            ihash.digest_into (u);
+            HASH ohash (key.outer ());
+            ohash.add (u, HASHLEN);
+            ohash.digest_into (t);
+            std::size_t const n = std::min<std::size_t> (HASHLEN, length - pos);
+            std::copy (t, t + n, okm + pos);
+            pos += n;
+        }
+    }
+
+    // OKM of length octets for each of infos, one after another into okm,
+    // which holds infos.size () * length octets.
+    void
+    expand (std::vector<octets::view> const& infos, std::uint8_t* okm,
+        std::size_t const length) const
+    {
+        for (std::size_t k = 0; k < infos.size (); ++k)
+            expand (infos[k], okm + k * length, length);
+    }
+
+private:
+    digest::HMAC_KEY<HASH> key;
+};
+
+template<class HASH>
+void
+hkdf_expand (octets::view const& prk, octets::view const& info,
+    std::uint8_t* okm, std::size_t const length)
+{
+    hkdf_expander<HASH> (prk).expand (info, okm, length);
+}
+
+template<class HASH>
+std::string
+hkdf (octets::view const& salt, octets::view const& ikm, octets::view const& info,
+    std::size_t const length)
+{
+    typename HASH::DIGEST const prk = hkdf_extract<HASH> (salt, ikm);
+    std::string okm (length, 0);
+    hkdf_expand<HASH> (prk, info, reinterpret_cast<std::uint8_t*> (&okm[0]), length);
+    return okm;
+}
+
+}//namespace rfc5869
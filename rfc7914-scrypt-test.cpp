@@ -0,0 +1,72 @@
+#include <string>
+#include <stdexcept>
+#include "rfc7914-scrypt.hpp"
+#include "mime-base16.hpp"
+#include "taptests.hpp"
+
+// RFC 7914 12. Test Vectors for scrypt
+void
+test_scrypt_vectors (test::simple& ts, rfc7914::engine_type const e, std::string const& name)
+{
+    if (! rfc7914::select_engine (e)) {
+        ts.diag (name + " engine is not available, testing the portable one.");
+        rfc7914::select_engine (rfc7914::ENGINE_PORTABLE);
+    }
+    ts.ok (mime::encode_hex (rfc7914::scrypt ("", "", 16, 1, 1, 64))
+        == "77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+           "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906",
+        "scrypt " + name + " vector 1");
+    ts.ok (mime::encode_hex (rfc7914::scrypt ("password", "NaCl", 1024, 8, 16, 64))
+        == "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+           "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640",
+        "scrypt " + name + " vector 2");
+    ts.ok (mime::encode_hex (rfc7914::scrypt ("pleaseletmein", "SodiumChloride", 16384, 8, 1, 64))
+        == "7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+           "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887",
+        "scrypt " + name + " vector 3");
+    // an odd r and p, with the key checked against Python hashlib.scrypt
+    ts.ok (mime::encode_hex (rfc7914::scrypt ("pw", "salt", 64, 3, 5, 100))
+        == "6e2434fae1aa4e97719c006277d6e196ab2d04dd05a623e4d27c78aa75893607"
+           "485f345c031eef3b46c65f3250c08837270dab2ae5ed1f3e7205671dd4632f52"
+           "e4ad4b2e5dd0f266b86470284a812c4cce1b387ed3c4b46203d44cd9f6245342"
+           "ebef4fad",
+        "scrypt " + name + " r=3");
+}
+
+void
+test_scrypt_threads (test::simple& ts)
+{
+    rfc7914::select_engine (rfc7914::ENGINE_AUTO);
+    std::string const serial = rfc7914::scrypt ("password", "NaCl", 1024, 8, 16, 64, 1);
+    ts.ok (rfc7914::scrypt ("password", "NaCl", 1024, 8, 16, 64, 4) == serial
+        && rfc7914::scrypt ("password", "NaCl", 1024, 8, 16, 64, 32) == serial,
+        "scrypt p lanes on threads");
+}
+
+void
+test_scrypt_parameters (test::simple& ts)
+{
+    int nthrown = 0;
+    try { rfc7914::scrypt ("password", "NaCl", 1000, 8, 1, 64); }
+    catch (std::runtime_error const&) { ++nthrown; }
+    try { rfc7914::scrypt ("password", "NaCl", 1, 8, 1, 64); }
+    catch (std::runtime_error const&) { ++nthrown; }
+    try { rfc7914::scrypt ("password", "NaCl", 1024, 8, 1U << 28, 64); }
+    catch (std::runtime_error const&) { ++nthrown; }
+    try { rfc7914::scrypt ("password", "NaCl", 1ULL << 16, 1, 1, 64); }
+    catch (std::runtime_error const&) { ++nthrown; }
+    ts.ok (4 == nthrown, "scrypt invalid parameters");
+}
+
+int
+main ()
+{
+    test::simple ts (10);
+
+    test_scrypt_vectors (ts, rfc7914::ENGINE_PORTABLE, "portable");
+    test_scrypt_vectors (ts, rfc7914::ENGINE_SSE2, "sse2");
+    test_scrypt_threads (ts);
+    test_scrypt_parameters (ts);
+
+    return ts.done_testing ();
+}
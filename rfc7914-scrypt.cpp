@@ -0,0 +1,312 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <system_error>
+#include "digest.hpp"
+#include "pkcs5-pbkdf2.hpp"
+#include "rfc7914-scrypt.hpp"
+#include "cpu-features.hpp"
+#if defined (CPU_FEATURES_X86)
+#include <emmintrin.h>
+#endif
+
+// scrypt
+//
+// ROMix keeps each 64 octets Salsa20 block with its words in the
+// diagonal order, word i * 5 % 16 at position i, so that the SSE2 core
+// runs on the four diagonals of the matrix as four vectors. blocks
+// are reordered when they are read from and written back to B.
+
+namespace rfc7914 {
+
+enum { SALSA_WORDS = 16, CACHE_LINE = 64 };
+
+static inline std::uint32_t
+rotate_left (std::uint32_t const x, int const n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline void
+qround (std::uint32_t& a, std::uint32_t& b, std::uint32_t& c, std::uint32_t& d)
+{
+    b ^= rotate_left (a + d, 7);
+    c ^= rotate_left (b + a, 9);
+    d ^= rotate_left (c + b, 13);
+    a ^= rotate_left (d + c, 18);
+}
+
+// b = b + Salsa20/8 (b) on a block in the diagonal order
+static void
+salsa20_8_portable (std::uint32_t b[SALSA_WORDS])
+{
+    std::uint32_t x[SALSA_WORDS];
+    for (int i = 0; i < SALSA_WORDS; ++i)
+        x[i * 5 % 16] = b[i];
+    for (int round = 0; round < 8; round += 2) {
+        qround (x[ 0], x[ 4], x[ 8], x[12]);
+        qround (x[ 5], x[ 9], x[13], x[ 1]);
+        qround (x[10], x[14], x[ 2], x[ 6]);
+        qround (x[15], x[ 3], x[ 7], x[11]);
+        qround (x[ 0], x[ 1], x[ 2], x[ 3]);
+        qround (x[ 5], x[ 6], x[ 7], x[ 4]);
+        qround (x[10], x[11], x[ 8], x[ 9]);
+        qround (x[15], x[12], x[13], x[14]);
+    }
+    for (int i = 0; i < SALSA_WORDS; ++i)
+        b[i] += x[i * 5 % 16];
+}
+
+// y = BlockMix (x) of 2 * r blocks
+static void
+blockmix_portable (std::uint32_t const* x, std::uint32_t* y, std::size_t const r)
+{
+    std::uint32_t t[SALSA_WORDS];
+    std::copy (x + (2 * r - 1) * SALSA_WORDS, x + 2 * r * SALSA_WORDS, t);
+    for (std::size_t i = 0; i < 2 * r; ++i) {
+        for (int k = 0; k < SALSA_WORDS; ++k)
+            t[k] ^= x[i * SALSA_WORDS + k];
+        salsa20_8_portable (t);
+        std::size_t const j = (i & 1) == 0 ? i / 2 : r + i / 2;
+        std::copy (t, t + SALSA_WORDS, y + j * SALSA_WORDS);
+    }
+}
+
+#if defined (CPU_FEATURES_X86)
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+rotate_left_x4 (__m128i const x, int const n)
+{
+    return _mm_or_si128 (_mm_slli_epi32 (x, n), _mm_srli_epi32 (x, 32 - n));
+}
+
+// the four diagonals take the quarter rounds of the columns at once,
+// and after rotating the lanes, those of the rows.
+__attribute__ ((target ("sse2")))
+static inline void
+salsa20_8_sse2 (__m128i& b0, __m128i& b1, __m128i& b2, __m128i& b3)
+{
+    __m128i x0 = b0, x1 = b1, x2 = b2, x3 = b3;
+    for (int round = 0; round < 8; round += 2) {
+        x1 = _mm_xor_si128 (x1, rotate_left_x4 (_mm_add_epi32 (x0, x3), 7));
+        x2 = _mm_xor_si128 (x2, rotate_left_x4 (_mm_add_epi32 (x1, x0), 9));
+        x3 = _mm_xor_si128 (x3, rotate_left_x4 (_mm_add_epi32 (x2, x1), 13));
+        x0 = _mm_xor_si128 (x0, rotate_left_x4 (_mm_add_epi32 (x3, x2), 18));
+        x1 = _mm_shuffle_epi32 (x1, 0x93);
+        x2 = _mm_shuffle_epi32 (x2, 0x4e);
+        x3 = _mm_shuffle_epi32 (x3, 0x39);
+        x3 = _mm_xor_si128 (x3, rotate_left_x4 (_mm_add_epi32 (x0, x1), 7));
+        x2 = _mm_xor_si128 (x2, rotate_left_x4 (_mm_add_epi32 (x3, x0), 9));
+        x1 = _mm_xor_si128 (x1, rotate_left_x4 (_mm_add_epi32 (x2, x3), 13));
+        x0 = _mm_xor_si128 (x0, rotate_left_x4 (_mm_add_epi32 (x1, x2), 18));
+        x1 = _mm_shuffle_epi32 (x1, 0x39);
+        x2 = _mm_shuffle_epi32 (x2, 0x4e);
+        x3 = _mm_shuffle_epi32 (x3, 0x93);
+    }
+    b0 = _mm_add_epi32 (b0, x0);
+    b1 = _mm_add_epi32 (b1, x1);
+    b2 = _mm_add_epi32 (b2, x2);
+    b3 = _mm_add_epi32 (b3, x3);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+blockmix_sse2 (std::uint32_t const* x, std::uint32_t* y, std::size_t const r)
+{
+    __m128i const* src = reinterpret_cast<__m128i const*> (x);
+    __m128i* dst = reinterpret_cast<__m128i*> (y);
+    __m128i t0 = _mm_load_si128 (src + (2 * r - 1) * 4 + 0);
+    __m128i t1 = _mm_load_si128 (src + (2 * r - 1) * 4 + 1);
+    __m128i t2 = _mm_load_si128 (src + (2 * r - 1) * 4 + 2);
+    __m128i t3 = _mm_load_si128 (src + (2 * r - 1) * 4 + 3);
+    for (std::size_t i = 0; i < 2 * r; ++i) {
+        t0 = _mm_xor_si128 (t0, _mm_load_si128 (src + i * 4 + 0));
+        t1 = _mm_xor_si128 (t1, _mm_load_si128 (src + i * 4 + 1));
+        t2 = _mm_xor_si128 (t2, _mm_load_si128 (src + i * 4 + 2));
+        t3 = _mm_xor_si128 (t3, _mm_load_si128 (src + i * 4 + 3));
+        salsa20_8_sse2 (t0, t1, t2, t3);
+        std::size_t const j = (i & 1) == 0 ? i / 2 : r + i / 2;
+        _mm_store_si128 (dst + j * 4 + 0, t0);
+        _mm_store_si128 (dst + j * 4 + 1, t1);
+        _mm_store_si128 (dst + j * 4 + 2, t2);
+        _mm_store_si128 (dst + j * 4 + 3, t3);
+    }
+}
+
+#endif
+
+static engine_type
+detect_engine ()
+{
+    if (cpu::has_sse2 ())
+        return ENGINE_SSE2;
+    return ENGINE_PORTABLE;
+}
+
+static engine_type scrypt_engine = detect_engine ();
+
+bool
+select_engine (engine_type const e)
+{
+    engine_type const available = detect_engine ();
+    if (ENGINE_AUTO == e)
+        scrypt_engine = available;
+    else if (ENGINE_SSE2 == e && ENGINE_SSE2 != available)
+        return false;
+    else
+        scrypt_engine = e;
+    return true;
+}
+
+engine_type
+engine ()
+{
+    return scrypt_engine;
+}
+
+// workspace of a thread, V of n blocks of 128 * r octets, X and Y,
+// on cache line boundaries.
+class romix_buffer {
+public:
+    romix_buffer (std::size_t const r, std::uint64_t const n)
+        : mwords (32 * r), mbuf ((n + 2) * mwords + CACHE_LINE / sizeof (std::uint32_t))
+    {
+        std::uintptr_t const addr = reinterpret_cast<std::uintptr_t> (mbuf.data ());
+        std::size_t const skip = (CACHE_LINE - addr % CACHE_LINE) % CACHE_LINE;
+        mv = mbuf.data () + skip / sizeof (std::uint32_t);
+    }
+
+    std::size_t words () const { return mwords; }
+    std::uint32_t* v (std::uint64_t const i) { return mv + i * mwords; }
+
+private:
+    std::size_t mwords;
+    std::vector<std::uint32_t> mbuf;
+    std::uint32_t* mv;
+};
+
+// B = ROMix (B) for one lane of 128 * r octets
+static void
+romix (std::uint8_t* b, std::size_t const r, std::uint64_t const n, romix_buffer& buf)
+{
+    void (*blockmix)(std::uint32_t const*, std::uint32_t*, std::size_t) = blockmix_portable;
+#if defined (CPU_FEATURES_X86)
+    if (ENGINE_SSE2 == scrypt_engine)
+        blockmix = blockmix_sse2;
+#endif
+    std::size_t const words = buf.words ();
+    std::uint32_t* x = buf.v (n);
+    std::uint32_t* y = buf.v (n + 1);
+    for (std::size_t k = 0; k < words; k += SALSA_WORDS)
+        for (int i = 0; i < SALSA_WORDS; ++i) {
+            std::uint8_t const* s = b + (k + i * 5 % 16) * 4;
+            x[k + i] = s[0] | (s[1] << 8) | (s[2] << 16)
+                | (static_cast<std::uint32_t> (s[3]) << 24);
+        }
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::copy (x, x + words, buf.v (i));
+        blockmix (x, y, r);
+        std::swap (x, y);
+    }
+    // Integerify takes the first word of the last block, and the
+    // second word at position 13 in the diagonal order.
+    std::size_t const last = words - SALSA_WORDS;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::uint64_t const j = (x[last] | (static_cast<std::uint64_t> (x[last + 13]) << 32))
+            & (n - 1);
+        std::uint32_t const* v = buf.v (j);
+        for (std::size_t k = 0; k < words; ++k)
+            x[k] ^= v[k];
+        blockmix (x, y, r);
+        std::swap (x, y);
+    }
+    for (std::size_t k = 0; k < words; k += SALSA_WORDS)
+        for (int i = 0; i < SALSA_WORDS; ++i) {
+            std::uint8_t* d = b + (k + i * 5 % 16) * 4;
+            d[0] = x[k + i] & 0xff;
+            d[1] = (x[k + i] >> 8) & 0xff;
+            d[2] = (x[k + i] >> 16) & 0xff;
+            d[3] = (x[k + i] >> 24) & 0xff;
+        }
+}
+
+std::string
+scrypt (std::string const& password, std::string const& salt,
+    std::uint64_t const n, std::uint32_t const r, std::uint32_t const p,
+    std::size_t const dklen, std::size_t nthread)
+{
+    if (n < 2 || (n & (n - 1)) != 0)
+        throw std::runtime_error ("scrypt n must be a power of 2 greater than 1.");
+    if (r == 0 || p == 0 || static_cast<std::uint64_t> (r) * p >= (1ULL << 30))
+        throw std::runtime_error ("scrypt r * p must be in 1 .. 2^30 - 1.");
+    if (r < 4U && n >= (1ULL << (16U * r)))
+        throw std::runtime_error ("scrypt n must be less than 2^(128 * r / 8).");
+    if (n + 2 > SIZE_MAX / 128U / r || p > SIZE_MAX / 128U / r)
+        throw std::runtime_error ("scrypt 128 * r * n is too large.");
+    typedef digest::HMAC<digest::SHA256> PRF;
+    std::size_t const lane = 128U * r;
+    std::string b = pkcs5::pbkdf2<PRF> (password, salt, 1, p * lane);
+    std::uint8_t* const base = reinterpret_cast<std::uint8_t*> (&b[0]);
+    if (0 == nthread)
+        nthread = std::max<std::size_t> (1, std::thread::hardware_concurrency ());
+    nthread = std::min<std::size_t> (nthread, p);
+    // allocated here, so that running out of memory throws to the caller
+    std::vector<romix_buffer> buf;
+    buf.reserve (nthread);
+    for (std::size_t k = 0; k < nthread; ++k)
+        buf.emplace_back (r, n);
+    std::atomic<std::uint32_t> next (0);
+    auto work = [&] (std::size_t const k) {
+        for (std::uint32_t i; (i = next++) < p; )
+            romix (base + i * lane, r, n, buf[k]);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve (nthread - 1);
+    try {
+        while (workers.size () < nthread - 1)
+            workers.emplace_back (work, workers.size () + 1);
+    }
+    catch (std::system_error const&) {
+        // leave the rest of the lanes to the started threads and to us
+    }
+    work (0);
+    for (std::thread& worker : workers)
+        worker.join ();
+    return pkcs5::pbkdf2<PRF> (password, b, 1, dklen);
+}
+
+}//namespace rfc7914
+
+/* Copyright (c) 2016, MIZUTANI Tociyuki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
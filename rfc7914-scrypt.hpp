@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace rfc7914 {
+
+// Salsa20/8 cores of the scrypt BlockMix.
+// ENGINE_AUTO picks SSE2 when the cpu has it.
+enum engine_type { ENGINE_AUTO, ENGINE_PORTABLE, ENGINE_SSE2 };
+bool select_engine (engine_type const e);
+engine_type engine ();
+
+// The scrypt Password-Based Key Derivation Function
+// see RFC 7914
+//
+// n is the CPU/memory cost, a power of 2 greater than 1, r the block
+// size and p the parallelization. the p ROMix lanes run on up to nthread
+// threads, nthread 0 meaning one per hardware thread, and each thread
+// takes 128 * r * n octets. invalid parameters throw std::runtime_error.
+std::string scrypt (std::string const& password, std::string const& salt,
+    std::uint64_t const n, std::uint32_t const r, std::uint32_t const p,
+    std::size_t const dklen, std::size_t nthread = 0);
+
+}//namespace rfc7914